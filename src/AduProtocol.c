@@ -30,17 +30,47 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "AduProtocol.h"
 #include "Watchdog.h"
 #include "EventCounter.h"
+#include "LatencyStats.h"
 #include "boards/Board.h"
 
 #include <stdbool.h>
 #include <ctype.h>
 #include <string.h>
-#include <stdlib.h>
 
-// The largest ADU command currently defined is the "MKddd" command
-#define MAX_CMD_STR_SIZE    5
+// The largest ADU command currently defined is the "WMhhhh" command, and the
+// largest response is a tagged 5-digit event count (e.g. "@7" + "65535")
+#define MAX_CMD_STR_SIZE    6
 #define MAX_RSP_BUF_SIZE    8
 
+// Commands within a batch are separated by this character. A report whose
+// payload ends with the delimiter continues the batch in the next report.
+#define BATCH_DELIMITER     ';'
+#define MAX_BATCH_STR_SIZE  64
+
+// Enough queued responses for a maximal batch of the shortest responding
+// command (e.g. "PI;PI;...;PI"), plus responses to earlier tagged commands
+// that the host has not fetched yet. One more entry is kept spare, so that
+// running out of room can always be reported.
+#define MAX_BATCH_RESPONSES (MAX_BATCH_STR_SIZE / 3 + 1)
+#define RSP_PIPELINE_DEPTH  8
+#define RSP_QUEUE_SIZE      (MAX_BATCH_RESPONSES + RSP_PIPELINE_DEPTH + 1)
+
+// A command may be prefixed with this character and a one-character tag
+// chosen by the host (e.g. "@7RPA0"). Every tagged command elicits a response
+// beginning with the same prefix and tag, followed by either the normal
+// response data (if any) or an error response.
+#define TAG_PREFIX          '@'
+#define TAG_PREFIX_LEN      2
+
+// An error response is the failure character followed by an error code
+// character identifying why the command failed (e.g. "?2")
+#define TAG_FAILURE         '?'
+#define ERROR_RSP_LEN       2
+#define ERROR_UNKNOWN_COMMAND       '1'
+#define ERROR_INVALID_ARGUMENT      '2'
+#define ERROR_COMMAND_TOO_LONG      '3'
+#define ERROR_RESPONSE_QUEUE_FULL   '4'
+
 #define NUM_RELAYS          8
 
 #define INPUT_PORT_NUM_PINS 4
@@ -54,12 +84,61 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define DEC_DIGITS_8_BIT    3
 #define DEC_DIGITS_16_BIT   5
 
+#define HEX_DIGITS_8_BIT    2
+
 /** Buffer for storing the response to the latest command */
 static uint8_t ResponseBuf[MAX_RSP_BUF_SIZE];
 
 /** The size of the response data in the buffer */
 static size_t ResponseBufLen;
 
+/**
+ * Whether untagged commands that fail are answered with an error response
+ * (tagged commands always are). This is off by default, as on the ADU218,
+ * which never answers failed commands.
+ */
+static bool ErrorResponses;
+
+/** A response waiting to be sent to the host */
+struct QueuedResponse
+{
+    uint8_t Data[MAX_RSP_BUF_SIZE];
+    uint8_t Len;
+
+    /** Whether this responds to a tagged command */
+    bool Tagged;
+};
+
+/** Responses that have not yet been fetched by the host, oldest first */
+static struct QueuedResponse ResponseQueue[RSP_QUEUE_SIZE];
+static unsigned ResponseQueueHead;
+static unsigned ResponseQueueCount;
+
+/** Command text accumulated across the reports of a multi-report batch */
+static char BatchBuf[MAX_BATCH_STR_SIZE + 1];
+static size_t BatchBufLen;
+
+/**
+ * The digital inputs, latched once at the start of a batch so that every
+ * command in the batch observes the same input state
+ */
+static uint8_t BatchInputs;
+
+/**
+ * Relay changes staged by the commands of a batch. These are applied to the
+ * relay port in a single update once the whole batch has been processed, so
+ * the relays never pass through the intermediate states of the batch.
+ */
+static uint8_t BatchRelaySetMask;
+static uint8_t BatchRelayClearMask;
+static uint8_t BatchRelayToggleMask;
+
+/**
+ * Whether the response queue ran out of room during the current batch, in
+ * which case the rest of the batch is not executed
+ */
+static bool BatchAborted;
+
 /** Represents one of the digital input ports */
 enum InputPort
 {
@@ -149,7 +228,7 @@ static uint8_t GetInputPortValue(char inputPortChar)
     }
     else
     {
-        uint8_t combinedPortValue = BoardReadDigitalInputs();
+        uint8_t combinedPortValue = BatchInputs;
 
         // Isolate the value of the requested port
         unsigned portShift = INPUT_PORT_A_SHIFT;
@@ -215,6 +294,145 @@ static void WriteResponseDecimal(uint16_t value, uint8_t numDigits)
     ResponseBufLen = numDigits;
 }
 
+/**
+ * Stages a change to the relay port, to be applied when the current batch
+ * completes. Bits present in both masks are set.
+ *
+ * @param[in] setMask The relays to close
+ * @param[in] clearMask The relays to open
+ */
+static void StageRelays(uint8_t setMask, uint8_t clearMask)
+{
+    BatchRelayClearMask = (BatchRelayClearMask | clearMask) & ~setMask;
+    BatchRelaySetMask = (BatchRelaySetMask & ~clearMask) | setMask;
+
+    // Setting or clearing a relay overrides any earlier toggle of it
+    BatchRelayToggleMask &= ~(setMask | clearMask);
+}
+
+/**
+ * Stages a toggle of some of the relays, to be applied when the current batch
+ * completes. The toggle is applied to the state of the relays at that time,
+ * rather than to the state read back now, so it can't undo a change made from
+ * interrupt context in the meantime (e.g. the end of a relay pulse).
+ *
+ * @param[in] toggleMask The relays to toggle
+ */
+static void StageRelayToggle(uint8_t toggleMask)
+{
+    BatchRelayToggleMask ^= toggleMask;
+}
+
+/**
+ * Reads the relay port as it will be once the current batch completes, so
+ * that commands later in a batch observe the changes of earlier commands
+ *
+ * @return The staged "PORTK" relays state
+ */
+static uint8_t ReadStagedRelays()
+{
+    return ((BoardReadRelays() & ~BatchRelayClearMask) | BatchRelaySetMask) ^ BatchRelayToggleMask;
+}
+
+/**
+ * Converts a command character to upper case. Unlike toupper(), this doesn't
+ * consult the C library's locale tables, so it's just a compare and subtract.
+ *
+ * @param[in] c The character to convert
+ *
+ * @return The upper case equivalent of @p c, or @p c if it's not a letter
+ */
+static inline char CommandCharToUpper(char c)
+{
+    return (c >= 'a' && c <= 'z') ? c - ('a' - 'A') : c;
+}
+
+/**
+ * Decodes a single decimal digit from a command argument
+ *
+ * @param[in] c The argument character to decode
+ * @param[in] limit The exclusive upper bound on the decoded value
+ * @param[out] value The decoded value, only written on success
+ *
+ * @return Returns true if @p c is a decimal digit less than @p limit, or false
+ *         otherwise
+ */
+static bool DecodeDigit(char c, unsigned limit, unsigned *value)
+{
+    // Characters below '0' wrap around to large unsigned values
+    unsigned digit = (unsigned)(c - '0');
+
+    if (digit > 9 || digit >= limit)
+        return false;
+
+    *value = digit;
+    return true;
+}
+
+/**
+ * Decodes a fixed-width field of decimal digits from a command argument. This
+ * is stricter than strtoul(), in that the field must consist of 1 to
+ * @p maxDigits digits and nothing else (no whitespace, sign, or empty field).
+ *
+ * @param[in] args The argument characters to decode
+ * @param[in] len The number of argument characters
+ * @param[in] maxDigits The maximum number of digits in the field
+ * @param[out] value The decoded value, only written on success
+ *
+ * @return Returns true on success or false on failure
+ */
+static bool DecodeDecimal(const char *args, size_t len, size_t maxDigits, unsigned *value)
+{
+    if (len == 0 || len > maxDigits)
+        return false;
+
+    unsigned result = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        unsigned digit = (unsigned)(args[i] - '0');
+        if (digit > 9)
+            return false;
+
+        result = result * 10 + digit;
+    }
+
+    *value = result;
+    return true;
+}
+
+/**
+ * Decodes a fixed-width field of hexadecimal digits (case-insensitive) from a
+ * command argument. The field must consist of exactly @p numDigits digits.
+ *
+ * @param[in] args The argument characters to decode
+ * @param[in] numDigits The number of digits in the field
+ * @param[out] value The decoded value, only written on success
+ *
+ * @return Returns true on success or false on failure
+ */
+static bool DecodeHex(const char *args, size_t numDigits, unsigned *value)
+{
+    unsigned result = 0;
+
+    for (size_t i = 0; i < numDigits; i++)
+    {
+        char c = CommandCharToUpper(args[i]);
+        unsigned digit;
+
+        if (c >= '0' && c <= '9')
+            digit = c - '0';
+        else if (c >= 'A' && c <= 'F')
+            digit = c - 'A' + 10;
+        else
+            return false;
+
+        result = (result << 4) | digit;
+    }
+
+    *value = result;
+    return true;
+}
+
 /**
  * Handler for the "RPy" or "RPyn" command, which responds with the status of
  * input line n (where n is '0', '1', '2', or '3') on port y (where y is 'A' or
@@ -225,15 +443,15 @@ static void WriteResponseDecimal(uint16_t value, uint8_t numDigits)
  * @post On success, populates the response buffer with the port status
  *
  * @param[in] args The non-fixed portion of the command string (if any)
+ * @param[in] len The number of characters in @p args
  *
  * @return Returns true on success or false on failure
  */
-static bool HandlerReadSinglePort(const char *args)
+static bool HandlerReadSinglePort(const char *args, size_t len)
 {
     BoardDebugPrint("Hit %s\r\n", __func__);
 
     bool success = false;
-    size_t len = strlen(args);
 
     // We only accept the formats "RPy" or "RPyn", where y is the port to read
     // ('A' or 'B') and n is the line to read ('0', '1', '2', or '3')
@@ -246,11 +464,9 @@ static bool HandlerReadSinglePort(const char *args)
             // If requesting a specific input line
             if (len == 2)
             {
-                char *endptr;
-                unsigned long line = strtoul(&args[1], &endptr, 10);
+                unsigned line;
 
-                // Check that the conversion was valid and in range
-                if (*endptr == '\0' && line < INPUT_PORT_NUM_PINS)
+                if (DecodeDigit(args[1], INPUT_PORT_NUM_PINS, &line))
                 {
                     WriteResponseBinary((portValue & (1 << line)) != 0, 1);
                     success = true;
@@ -284,17 +500,18 @@ static bool HandlerReadSinglePort(const char *args)
  * @post On success, populates the response buffer with the port status
  *
  * @param[in] args The non-fixed portion of the command string (if any)
+ * @param[in] len The number of characters in @p args
  *
  * @return Returns true on success or false on failure
  */
-static bool HandlerReadSinglePortDecimal(const char *args)
+static bool HandlerReadSinglePortDecimal(const char *args, size_t len)
 {
     BoardDebugPrint("Hit %s\r\n", __func__);
 
     bool success = false;
 
     // We expect exactly one character argument
-    if (strlen(args) == 1)
+    if (len == 1)
     {
         uint8_t portValue = GetInputPortValue(args[0]);
         if (portValue != 0xff)
@@ -319,19 +536,20 @@ static bool HandlerReadSinglePortDecimal(const char *args)
  * @post On success, populates the response buffer with the port status
  *
  * @param[in] args The non-fixed portion of the command string (if any)
+ * @param[in] len The number of characters in @p args
  *
  * @return Returns true on success or false on failure
  */
-static bool HandlerReadCombinedPortsDecimal(const char *args)
+static bool HandlerReadCombinedPortsDecimal(const char *args, size_t len)
 {
     BoardDebugPrint("Hit %s\r\n", __func__);
 
     bool success = false;
 
     // There should be no character arguments to this command
-    if (strlen(args) == 0)
+    if (len == 0)
     {
-        WriteResponseDecimal(BoardReadDigitalInputs(), DEC_DIGITS_8_BIT);
+        WriteResponseDecimal(BatchInputs, DEC_DIGITS_8_BIT);
         success = true;
     }
 
@@ -343,30 +561,24 @@ static bool HandlerReadCombinedPortsDecimal(const char *args)
  * n is a value from '0' to '7'). This command does not have a response.
  *
  * @param[in] args The non-fixed portion of the command string (if any)
+ * @param[in] len The number of characters in @p args
  *
  * @return Returns true on success or false on failure
  */
-static bool HandlerSetRelay(const char *args)
+static bool HandlerSetRelay(const char *args, size_t len)
 {
     BoardDebugPrint("Hit %s\r\n", __func__);
 
     bool success = false;
+    unsigned relay;
 
     // There should be exactly one character argument to this command
-    if (strlen(args) == 1)
+    if (len == 1 && DecodeDigit(args[0], NUM_RELAYS, &relay))
     {
-        char *endptr;
-        unsigned long relay = strtoul(args, &endptr, 10);
-
-        if (*endptr == '\0' && relay < NUM_RELAYS)
-        {
-            // Set the bit corresponding to the specified relay
-            uint8_t relayPort = BoardReadRelays();
-            relayPort |= (1 << relay);
-            BoardWriteRelays(relayPort);
+        // Set the bit corresponding to the specified relay
+        StageRelays(1 << relay, 0);
 
-            success = true;
-        }
+        success = true;
     }
 
     return success;
@@ -377,29 +589,23 @@ static bool HandlerSetRelay(const char *args)
  * n is a value from '0' to '7'). This command does not have a response.
  *
  * @param[in] args The non-fixed portion of the command string (if any)
+ * @param[in] len The number of characters in @p args
  *
  * @return Returns true on success or false on failure
  */
-static bool HandlerClearRelay(const char *args)
+static bool HandlerClearRelay(const char *args, size_t len)
 {
     BoardDebugPrint("Hit %s\r\n", __func__);
     bool success = false;
+    unsigned relay;
 
     // There should be exactly one character argument to this command
-    if (strlen(args) == 1)
+    if (len == 1 && DecodeDigit(args[0], NUM_RELAYS, &relay))
     {
-        char *endptr;
-        unsigned long relay = strtoul(args, &endptr, 10);
-
-        if (*endptr == '\0' && relay < NUM_RELAYS)
-        {
-            // Clear the bit corresponding to the specified relay
-            uint8_t relayPort = BoardReadRelays();
-            relayPort &= ~(1 << relay);
-            BoardWriteRelays(relayPort);
+        // Clear the bit corresponding to the specified relay
+        StageRelays(0, 1 << relay);
 
-            success = true;
-        }
+        success = true;
     }
 
     return success;
@@ -411,27 +617,132 @@ static bool HandlerClearRelay(const char *args)
  * response.
  *
  * @param[in] args The non-fixed portion of the command string (if any)
+ * @param[in] len The number of characters in @p args
  *
  * @return Returns true on success or false on failure
  */
-static bool HandlerWriteRelayPort(const char *args)
+static bool HandlerWriteRelayPort(const char *args, size_t len)
 {
     BoardDebugPrint("Hit %s\r\n", __func__);
 
     bool success = false;
+    unsigned portValue;
 
     // There should be no more than 3 decimal characters/digital representing
     // the 8-bit value to write to the relay port
-    if (strlen(args) <= 3)
+    if (DecodeDecimal(args, len, DEC_DIGITS_8_BIT, &portValue) &&
+        portValue <= UINT8_MAX)
     {
-        char *endptr;
-        unsigned long portValue = strtoul(args, &endptr, 10);
+        StageRelays(portValue, ~portValue);
+        success = true;
+    }
 
-        if (*endptr == '\0' && portValue <= UINT8_MAX)
-        {
-            BoardWriteRelays(portValue);
-            success = true;
-        }
+    return success;
+}
+
+/**
+ * Handler for the "SMddd" command, which closes every relay selected by the
+ * 8-bit mask indicated by the decimal string ddd, leaving the others alone.
+ * This command does not have a response.
+ *
+ * @param[in] args The non-fixed portion of the command string (if any)
+ * @param[in] len The number of characters in @p args
+ *
+ * @return Returns true on success or false on failure
+ */
+static bool HandlerSetRelayMask(const char *args, size_t len)
+{
+    BoardDebugPrint("Hit %s\r\n", __func__);
+
+    bool success = false;
+    unsigned mask;
+
+    if (DecodeDecimal(args, len, DEC_DIGITS_8_BIT, &mask) && mask <= UINT8_MAX)
+    {
+        StageRelays(mask, 0);
+        success = true;
+    }
+
+    return success;
+}
+
+/**
+ * Handler for the "RMddd" command, which opens every relay selected by the
+ * 8-bit mask indicated by the decimal string ddd, leaving the others alone.
+ * This command does not have a response.
+ *
+ * @param[in] args The non-fixed portion of the command string (if any)
+ * @param[in] len The number of characters in @p args
+ *
+ * @return Returns true on success or false on failure
+ */
+static bool HandlerClearRelayMask(const char *args, size_t len)
+{
+    BoardDebugPrint("Hit %s\r\n", __func__);
+
+    bool success = false;
+    unsigned mask;
+
+    if (DecodeDecimal(args, len, DEC_DIGITS_8_BIT, &mask) && mask <= UINT8_MAX)
+    {
+        StageRelays(0, mask);
+        success = true;
+    }
+
+    return success;
+}
+
+/**
+ * Handler for the "TMddd" command, which toggles every relay selected by the
+ * 8-bit mask indicated by the decimal string ddd, leaving the others alone.
+ * This command does not have a response.
+ *
+ * @param[in] args The non-fixed portion of the command string (if any)
+ * @param[in] len The number of characters in @p args
+ *
+ * @return Returns true on success or false on failure
+ */
+static bool HandlerToggleRelayMask(const char *args, size_t len)
+{
+    BoardDebugPrint("Hit %s\r\n", __func__);
+
+    bool success = false;
+    unsigned mask;
+
+    if (DecodeDecimal(args, len, DEC_DIGITS_8_BIT, &mask) && mask <= UINT8_MAX)
+    {
+        StageRelayToggle(mask);
+        success = true;
+    }
+
+    return success;
+}
+
+/**
+ * Handler for the "WMmmvv" command, which writes the relays selected by the
+ * 8-bit mask mm with the corresponding bits of the 8-bit value vv, leaving the
+ * others alone. Both are given as two hexadecimal digits, so that the fields
+ * are fixed-width. This command does not have a response.
+ *
+ * @param[in] args The non-fixed portion of the command string (if any)
+ * @param[in] len The number of characters in @p args
+ *
+ * @return Returns true on success or false on failure
+ */
+static bool HandlerWriteRelayMask(const char *args, size_t len)
+{
+    BoardDebugPrint("Hit %s\r\n", __func__);
+
+    bool success = false;
+    unsigned mask;
+    unsigned value;
+
+    if (len == 2 * HEX_DIGITS_8_BIT &&
+        DecodeHex(args, HEX_DIGITS_8_BIT, &mask) &&
+        DecodeHex(&args[HEX_DIGITS_8_BIT], HEX_DIGITS_8_BIT, &value))
+    {
+        StageRelays(value & mask, ~value & mask);
+        success = true;
     }
 
     return success;
@@ -444,28 +755,24 @@ static bool HandlerWriteRelayPort(const char *args)
  * @post On success, the response buffer is populated
  *
  * @param[in] args The non-fixed portion of the command string (if any)
+ * @param[in] len The number of characters in @p args
  *
  * @return Returns true on success or false on failure
  */
-static bool HandlerReadSingleRelay(const char *args)
+static bool HandlerReadSingleRelay(const char *args, size_t len)
 {
     BoardDebugPrint("Hit %s\r\n", __func__);
 
     bool success = false;
+    unsigned relay;
 
     // There should be exactly one character argument to this command
-    if (strlen(args) == 1)
+    if (len == 1 && DecodeDigit(args[0], NUM_RELAYS, &relay))
     {
-        char *endptr;
-        unsigned long relay = strtoul(args, &endptr, 10);
-
-        if (*endptr == '\0' && relay < NUM_RELAYS)
-        {
-            uint8_t relayPort = BoardReadRelays();
-            WriteResponseBinary((relayPort & (1 << relay)) != 0, 1);
+        uint8_t relayPort = ReadStagedRelays();
+        WriteResponseBinary((relayPort & (1 << relay)) != 0, 1);
 
-            success = true;
-        }
+        success = true;
     }
 
     return success;
@@ -478,19 +785,20 @@ static bool HandlerReadSingleRelay(const char *args)
  * @post On success, the response buffer is populated
  *
  * @param[in] args The non-fixed portion of the command string (if any)
+ * @param[in] len The number of characters in @p args
  *
  * @return Returns true on success or false on failure
  */
-static bool HandlerReadRelayPortDecimal(const char *args)
+static bool HandlerReadRelayPortDecimal(const char *args, size_t len)
 {
     BoardDebugPrint("Hit %s\r\n", __func__);
 
     bool success = false;
 
     // There should be no arguments to this command
-    if (strlen(args) == 0)
+    if (len == 0)
     {
-        WriteResponseDecimal(BoardReadRelays(), DEC_DIGITS_8_BIT);
+        WriteResponseDecimal(ReadStagedRelays(), DEC_DIGITS_8_BIT);
         success = true;
     }
 
@@ -504,26 +812,23 @@ static bool HandlerReadRelayPortDecimal(const char *args)
  * @post On success, the response buffer is populated
  *
  * @param[in] args The non-fixed portion of the command string (if any)
+ * @param[in] len The number of characters in @p args
  *
  * @return Returns true on success or false on failure
  */
-static bool HandlerReadEventCounter(const char *args)
+static bool HandlerReadEventCounter(const char *args, size_t len)
 {
     BoardDebugPrint("Hit %s\r\n", __func__);
 
     bool success = false;
+    unsigned index;
 
-    if (strlen(args) == 1)
+    if (len == 1 && DecodeDigit(args[0], EVENT_COUNTER_NUM_COUNTERS, &index))
     {
-        char *endptr;
-        unsigned long index = strtoul(args, &endptr, 10);
-
-        if (*endptr == '\0' && index < EVENT_COUNTER_NUM_COUNTERS)
-        {
-            uint16_t count = EventCounterRead(index, false);
-            WriteResponseDecimal(count, DEC_DIGITS_16_BIT);
-            success = true;
-        }
+        // The ADU protocol only has room for the low 16 bits of the count
+        uint16_t count = EventCounterRead(index, false);
+        WriteResponseDecimal(count, DEC_DIGITS_16_BIT);
+        success = true;
     }
 
     return success;
@@ -537,26 +842,23 @@ static bool HandlerReadEventCounter(const char *args)
  * @post On success, the response buffer is populated
  *
  * @param[in] args The non-fixed portion of the command string (if any)
+ * @param[in] len The number of characters in @p args
  *
  * @return Returns true on success or false on failure
  */
-static bool HandlerReadAndResetEventCounter(const char *args)
+static bool HandlerReadAndResetEventCounter(const char *args, size_t len)
 {
     BoardDebugPrint("Hit %s\r\n", __func__);
 
     bool success = false;
+    unsigned index;
 
-    if (strlen(args) == 1)
+    if (len == 1 && DecodeDigit(args[0], EVENT_COUNTER_NUM_COUNTERS, &index))
     {
-        char *endptr;
-        unsigned long index = strtoul(args, &endptr, 10);
-
-        if (*endptr == '\0' && index < EVENT_COUNTER_NUM_COUNTERS)
-        {
-            uint16_t count = EventCounterRead(index, true);
-            WriteResponseDecimal(count, DEC_DIGITS_16_BIT);
-            success = true;
-        }
+        // The ADU protocol only has room for the low 16 bits of the count
+        uint16_t count = EventCounterRead(index, true);
+        WriteResponseDecimal(count, DEC_DIGITS_16_BIT);
+        success = true;
     }
 
     return success;
@@ -566,25 +868,33 @@ static bool HandlerReadAndResetEventCounter(const char *args)
  * Handler for the "DB" or "DBn" command, which either gets ("DB" command) or
  * sets ("DBn" command), the debounce setting for the event counters. The value
  * of n ranges from '0' to '2' as follows: '0' = 10ms, '1' = 1ms, '2' = 100us.
+ * The "DBn" command applies to every input, and the "DB" command fails if the
+ * inputs were given different debounce times through the extended protocol.
  *
  * @post On success, the response buffer is populated for the "DB" command
  *
  * @param[in] args The non-fixed portion of the command string (if any)
+ * @param[in] len The number of characters in @p args
  *
  * @return Returns true on success or false on failure
  */
-static bool HandlerDebounceSetting(const char *args)
+static bool HandlerDebounceSetting(const char *args, size_t len)
 {
     BoardDebugPrint("Hit %s\r\n", __func__);
 
     bool success = false;
-    size_t len = strlen(args);
 
     if (len == 0)
     {
-        // Query the debounce setting and populate the response
-        uint32_t debounceTime = EventCounterDebounceTimeGet();
-        for (unsigned i = 0; i < DEBOUNCE_SETTING_NUM_SETTINGS; i++)
+        // Query the debounce setting and populate the response. The inputs
+        // only have a setting if they all share the same debounce time.
+        uint32_t debounceTime = EventCounterDebounceTimeGet(0);
+        bool uniform = true;
+
+        for (unsigned i = 1; i < EVENT_COUNTER_NUM_COUNTERS; i++)
+            uniform = uniform && EventCounterDebounceTimeGet(i) == debounceTime;
+
+        for (unsigned i = 0; uniform && i < DEBOUNCE_SETTING_NUM_SETTINGS; i++)
         {
             if (DEBOUNCE_TIMES_US[i] == debounceTime)
             {
@@ -597,13 +907,11 @@ static bool HandlerDebounceSetting(const char *args)
     else if (len == 1)
     {
         // Set the debounce time based on the command argument
-        char *endptr;
-        unsigned long setting = strtoul(args, &endptr, 10);
+        unsigned setting;
 
-        if (setting < DEBOUNCE_SETTING_NUM_SETTINGS)
+        if (DecodeDigit(args[0], DEBOUNCE_SETTING_NUM_SETTINGS, &setting))
         {
-            EventCounterDebounceTimeSet(DEBOUNCE_TIMES_US[setting]);
-            success = true;
+            success = EventCounterDebounceTimeSet(EVENT_COUNTER_ALL_INPUTS, DEBOUNCE_TIMES_US[setting]);
         }
     }
 
@@ -614,19 +922,21 @@ static bool HandlerDebounceSetting(const char *args)
  * Handler for the "WD" or "WDn" command, which either gets ("WD" command) or
  * sets ("WDn" command), the watchdog configuration. The value of n ranges
  * from '0' to '3' as follows: '0' = disabled, '1' = 1s, '2' = 10s, '3' = 1min.
+ * The "WD" command fails if the timeout was set to some other value through
+ * the extended protocol.
  *
  * @post On success, the response buffer is populated for the "WD" command
  *
  * @param[in] args The non-fixed portion of the command string (if any)
+ * @param[in] len The number of characters in @p args
  *
  * @return Returns true on success or false on failure
  */
-static bool HandlerWatchdogSetting(const char *args)
+static bool HandlerWatchdogSetting(const char *args, size_t len)
 {
     BoardDebugPrint("Hit %s\r\n", __func__);
 
     bool success = false;
-    size_t len = strlen(args);
 
     if (len == 0)
     {
@@ -645,18 +955,93 @@ static bool HandlerWatchdogSetting(const char *args)
     else if (len == 1)
     {
         // Update the current watchdog setting
-        char *endptr;
-        unsigned long setting = strtoul(args, &endptr, 10);
+        unsigned setting;
+
+        if (DecodeDigit(args[0], WATCHDOG_SETTING_NUM_SETTINGS, &setting))
+        {
+            success = WatchdogTimeoutSet(WATCHDOG_TIMES_US[setting]);
+        }
+    }
+
+    return success;
+}
+
+/**
+ * Handler for the "ER" or "ERn" command, which either gets ("ER" command) or
+ * sets ("ERn" command) whether failed untagged commands are answered with an
+ * error response. The value of n is '0' (no response, as on the ADU218) or
+ * '1' (error response).
+ *
+ * @post On success, the response buffer is populated for the "ER" command
+ *
+ * @param[in] args The non-fixed portion of the command string (if any)
+ * @param[in] len The number of characters in @p args
+ *
+ * @return Returns true on success or false on failure
+ */
+static bool HandlerErrorResponseSetting(const char *args, size_t len)
+{
+    BoardDebugPrint("Hit %s\r\n", __func__);
+
+    bool success = false;
+
+    if (len == 0)
+    {
+        WriteResponseDecimal(ErrorResponses, DEC_DIGITS_1_BIT);
+        success = true;
+    }
+    else if (len == 1)
+    {
+        unsigned setting;
 
-        if (setting < WATCHDOG_SETTING_NUM_SETTINGS)
+        if (DecodeDigit(args[0], 2, &setting))
         {
-            WatchdogTimeoutSet(WATCHDOG_TIMES_US[setting]);
+            ErrorResponses = setting != 0;
+            success = true;
         }
     }
 
     return success;
 }
 
+/** Identifies each of the commands understood by the command processor */
+enum CommandId
+{
+    // Commands for writing or querying relay states
+    COMMAND_SET_RELAY,
+    COMMAND_CLEAR_RELAY,
+    COMMAND_WRITE_RELAY_PORT,
+    COMMAND_READ_SINGLE_RELAY,
+    COMMAND_READ_RELAY_PORT,
+
+    // Commands for reading digital input pins
+    COMMAND_READ_SINGLE_PORT,
+    COMMAND_READ_SINGLE_PORT_DECIMAL,
+    COMMAND_READ_COMBINED_PORTS,
+
+    // Commands dealing with the event counters
+    COMMAND_READ_EVENT_COUNTER,
+    COMMAND_READ_AND_RESET_EVENT_COUNTER,
+    COMMAND_DEBOUNCE_SETTING,
+
+    // Commands dealing with the watchdog timer
+    COMMAND_WATCHDOG_SETTING,
+
+    // Commands dealing with the protocol itself
+    COMMAND_ERROR_RESPONSE_SETTING,
+
+    // Commands for changing several relays at once
+    COMMAND_SET_RELAY_MASK,
+    COMMAND_CLEAR_RELAY_MASK,
+    COMMAND_TOGGLE_RELAY_MASK,
+    COMMAND_WRITE_RELAY_MASK,
+
+    COMMAND_NUM_COMMANDS,
+
+    /** Returned by the command lookup when no command matches */
+    COMMAND_UNKNOWN = COMMAND_NUM_COMMANDS
+};
+
 /**
  * Command processor table entry. Associates a command handler function with
  * a command prefix string
@@ -668,8 +1053,7 @@ struct CommandProcessorEntry
 
     /**
      * The length of the command prefix (we could compute this dynamically with
-     * strlen() each time we search the command table, but why waste the
-     * cycles?)
+     * strlen() each time we dispatch a command, but why waste the cycles?)
      */
     size_t CommandPrefixLen;
 
@@ -678,10 +1062,11 @@ struct CommandProcessorEntry
      *
      * @param[in] args The portion of the command string containing argument
      *                 characters (if any)
+     * @param[in] len The number of characters in @p args
      *
      * @return Returns true on success or false on failure
      */
-    bool (*Handler)(const char *args);
+    bool (*Handler)(const char *args, size_t len);
 };
 
 /**
@@ -694,75 +1079,343 @@ struct CommandProcessorEntry
 #define CMD_PROCESSOR_ENTRY(prefix, handler) \
     { prefix, sizeof(prefix) - 1, handler }
 
-/** Table of handlers for processing each type of command */
-static const struct CommandProcessorEntry ENTRIES[] =
+/** Table of handlers for processing each type of command, indexed by ID */
+static const struct CommandProcessorEntry ENTRIES[COMMAND_NUM_COMMANDS] =
 {
-    // Commands for writing or querying relay states
-    // Note: The "RPK" command must appear in this table before the "RP"
-    // command since the first matching command handler is used, and "RPK" is
-    // a specialization of "RP" that requires a separate command handler.
-    CMD_PROCESSOR_ENTRY("SK", HandlerSetRelay),
-    CMD_PROCESSOR_ENTRY("RK", HandlerClearRelay),
-    CMD_PROCESSOR_ENTRY("MK", HandlerWriteRelayPort),
-    CMD_PROCESSOR_ENTRY("RPK", HandlerReadSingleRelay),
-    CMD_PROCESSOR_ENTRY("PK", HandlerReadRelayPortDecimal),
+    [COMMAND_SET_RELAY]                    = CMD_PROCESSOR_ENTRY("SK", HandlerSetRelay),
+    [COMMAND_CLEAR_RELAY]                  = CMD_PROCESSOR_ENTRY("RK", HandlerClearRelay),
+    [COMMAND_WRITE_RELAY_PORT]             = CMD_PROCESSOR_ENTRY("MK", HandlerWriteRelayPort),
+    [COMMAND_READ_SINGLE_RELAY]            = CMD_PROCESSOR_ENTRY("RPK", HandlerReadSingleRelay),
+    [COMMAND_READ_RELAY_PORT]              = CMD_PROCESSOR_ENTRY("PK", HandlerReadRelayPortDecimal),
+    [COMMAND_READ_SINGLE_PORT]             = CMD_PROCESSOR_ENTRY("RP", HandlerReadSinglePort),
+    [COMMAND_READ_SINGLE_PORT_DECIMAL]     = CMD_PROCESSOR_ENTRY("PA", HandlerReadSinglePortDecimal),
+    [COMMAND_READ_COMBINED_PORTS]          = CMD_PROCESSOR_ENTRY("PI", HandlerReadCombinedPortsDecimal),
+    [COMMAND_READ_EVENT_COUNTER]           = CMD_PROCESSOR_ENTRY("RE", HandlerReadEventCounter),
+    [COMMAND_READ_AND_RESET_EVENT_COUNTER] = CMD_PROCESSOR_ENTRY("RC", HandlerReadAndResetEventCounter),
+    [COMMAND_DEBOUNCE_SETTING]             = CMD_PROCESSOR_ENTRY("DB", HandlerDebounceSetting),
+    [COMMAND_WATCHDOG_SETTING]             = CMD_PROCESSOR_ENTRY("WD", HandlerWatchdogSetting),
+    [COMMAND_ERROR_RESPONSE_SETTING]       = CMD_PROCESSOR_ENTRY("ER", HandlerErrorResponseSetting),
+    [COMMAND_SET_RELAY_MASK]               = CMD_PROCESSOR_ENTRY("SM", HandlerSetRelayMask),
+    [COMMAND_CLEAR_RELAY_MASK]             = CMD_PROCESSOR_ENTRY("RM", HandlerClearRelayMask),
+    [COMMAND_TOGGLE_RELAY_MASK]            = CMD_PROCESSOR_ENTRY("TM", HandlerToggleRelayMask),
+    [COMMAND_WRITE_RELAY_MASK]             = CMD_PROCESSOR_ENTRY("WM", HandlerWriteRelayMask),
+};
 
-    // Commands for reading digital input pins
-    CMD_PROCESSOR_ENTRY("RP", HandlerReadSinglePort),
-    CMD_PROCESSOR_ENTRY("PA", HandlerReadSinglePortDecimal),
-    CMD_PROCESSOR_ENTRY("PI", HandlerReadCombinedPortsDecimal),
+/**
+ * Packs the two leading (upper case) characters of a command into a single
+ * switch key
+ */
+#define COMMAND_KEY(c0, c1) (((unsigned)(uint8_t)(c0) << 8) | (uint8_t)(c1))
 
-    // Commands dealing with the event counters
-    CMD_PROCESSOR_ENTRY("RE", HandlerReadEventCounter),
-    CMD_PROCESSOR_ENTRY("RC", HandlerReadAndResetEventCounter),
-    CMD_PROCESSOR_ENTRY("DB", HandlerDebounceSetting),
+/**
+ * Identifies the command in the provided command string. Every command is
+ * distinguished by its first two characters, except that "RPK" is a
+ * specialization of "RP" that requires a third character to tell apart, so
+ * this is a single switch (which the compiler turns into a jump table or
+ * decision tree) rather than a search of the command table.
+ *
+ * @param[in] cmd The command string
+ * @param[in] len The length of the command string
+ *
+ * @return The command ID, or COMMAND_UNKNOWN if no command matches
+ */
+static enum CommandId LookupCommand(const char *cmd, size_t len)
+{
+    enum CommandId id = COMMAND_UNKNOWN;
 
-    // Commands dealing with the watchdog timer
-    CMD_PROCESSOR_ENTRY("WD", HandlerWatchdogSetting),
-};
+    if (len >= 2)
+    {
+        switch (COMMAND_KEY(CommandCharToUpper(cmd[0]), CommandCharToUpper(cmd[1])))
+        {
+            case COMMAND_KEY('S', 'K'): id = COMMAND_SET_RELAY; break;
+            case COMMAND_KEY('R', 'K'): id = COMMAND_CLEAR_RELAY; break;
+            case COMMAND_KEY('M', 'K'): id = COMMAND_WRITE_RELAY_PORT; break;
+            case COMMAND_KEY('P', 'K'): id = COMMAND_READ_RELAY_PORT; break;
+            case COMMAND_KEY('P', 'A'): id = COMMAND_READ_SINGLE_PORT_DECIMAL; break;
+            case COMMAND_KEY('P', 'I'): id = COMMAND_READ_COMBINED_PORTS; break;
+            case COMMAND_KEY('R', 'E'): id = COMMAND_READ_EVENT_COUNTER; break;
+            case COMMAND_KEY('R', 'C'): id = COMMAND_READ_AND_RESET_EVENT_COUNTER; break;
+            case COMMAND_KEY('D', 'B'): id = COMMAND_DEBOUNCE_SETTING; break;
+            case COMMAND_KEY('W', 'D'): id = COMMAND_WATCHDOG_SETTING; break;
+            case COMMAND_KEY('E', 'R'): id = COMMAND_ERROR_RESPONSE_SETTING; break;
+            case COMMAND_KEY('S', 'M'): id = COMMAND_SET_RELAY_MASK; break;
+            case COMMAND_KEY('R', 'M'): id = COMMAND_CLEAR_RELAY_MASK; break;
+            case COMMAND_KEY('T', 'M'): id = COMMAND_TOGGLE_RELAY_MASK; break;
+            case COMMAND_KEY('W', 'M'): id = COMMAND_WRITE_RELAY_MASK; break;
+
+            case COMMAND_KEY('R', 'P'):
+                // Input ports are only ever 'A' or 'B', so a 'K' here
+                // unambiguously selects the relay port
+                if (len >= 3 && CommandCharToUpper(cmd[2]) == 'K')
+                    id = COMMAND_READ_SINGLE_RELAY;
+                else
+                    id = COMMAND_READ_SINGLE_PORT;
+                break;
 
-/** The number of entries in the command processor table */
-static const size_t NUM_ENTRIES = sizeof(ENTRIES) / sizeof(ENTRIES[0]);
+            default:
+                break;
+        }
+    }
 
-bool AduProtocolProcessCommand(const uint8_t *buf, size_t len)
+    return id;
+}
+
+/**
+ * Adds the response in the response buffer to the queue of responses waiting
+ * to be fetched by the host
+ */
+static void QueueResponse(bool tagged)
+{
+    if (ResponseQueueCount == RSP_QUEUE_SIZE)
+    {
+        BoardDebugPrint("%s: Response queue full\r\n", __func__);
+    }
+    else
+    {
+        unsigned tail = (ResponseQueueHead + ResponseQueueCount) % RSP_QUEUE_SIZE;
+        struct QueuedResponse *rsp = &ResponseQueue[tail];
+
+        memcpy(rsp->Data, ResponseBuf, ResponseBufLen);
+        rsp->Len = ResponseBufLen;
+        rsp->Tagged = tagged;
+        ResponseQueueCount++;
+    }
+}
+
+/**
+ * Execution statistics for each command type. Commands that match no command
+ * type (including over-length commands) are recorded under COMMAND_UNKNOWN,
+ * and the processing of each whole report under STATS_SLOT_REPORT.
+ */
+#define STATS_SLOT_REPORT   (COMMAND_UNKNOWN + 1)
+#define NUM_STATS_SLOTS     (STATS_SLOT_REPORT + 1)
+static struct LatencyStats CommandStats[NUM_STATS_SLOTS];
+
+/**
+ * Discards the queued responses to untagged commands that the host never
+ * fetched. Responses to tagged commands are kept, in order, until they are
+ * sent, since the host may have several tagged commands in flight.
+ */
+static void DiscardUntaggedResponses()
+{
+    unsigned count = 0;
+
+    for (unsigned i = 0; i < ResponseQueueCount; i++)
+    {
+        const struct QueuedResponse *rsp = &ResponseQueue[(ResponseQueueHead + i) % RSP_QUEUE_SIZE];
+
+        if (rsp->Tagged)
+        {
+            ResponseQueue[(ResponseQueueHead + count) % RSP_QUEUE_SIZE] = *rsp;
+            count++;
+        }
+    }
+
+    ResponseQueueCount = count;
+}
+
+/**
+ * Processes a single command, queuing its response (if any)
+ *
+ * @param[in] cmd The NULL terminated command string
+ * @param[in] cmdLen The length of the command string
+ *
+ * @return Returns true on success or false on failure
+ */
+static bool ProcessSingleCommand(const char *cmd, size_t cmdLen)
 {
     bool success = false;
-    bool handlerFound = false;
-    const char *args = (const char*)buf;
+    bool tagged = cmdLen >= TAG_PREFIX_LEN && cmd[0] == TAG_PREFIX;
+    char tag = 0;
+    char error = ERROR_COMMAND_TOO_LONG;
+    enum CommandId id = COMMAND_UNKNOWN;
+    uint32_t startTimeUs = BoardGetElapsedTimeUs();
 
-    // All ADU commands are short, NULL terminated strings, so verify that
-    if (strnlen(args, len) > MAX_CMD_STR_SIZE)
+    // Clear any previous response information
+    ResponseBufLen = 0;
+
+    // Strip off the tag (if any) to leave a plain ADU command
+    if (tagged)
+    {
+        tag = cmd[1];
+        cmd += TAG_PREFIX_LEN;
+        cmdLen -= TAG_PREFIX_LEN;
+    }
+
+    // A command is only executed if it can be answered, leaving the spare
+    // queue entry for reporting that it can't
+    if (ResponseQueueCount >= RSP_QUEUE_SIZE - 1)
+    {
+        BoardDebugPrint("%s: Response queue full\r\n", __func__);
+        error = ERROR_RESPONSE_QUEUE_FULL;
+        BatchAborted = true;
+    }
+    else if (cmdLen > MAX_CMD_STR_SIZE)
     {
+        // All ADU commands are short strings, so verify that
         BoardDebugPrint("%s: Command length too long\r\n", __func__);
     }
     else
     {
-        // Clear any previous response information
-        ResponseBufLen = 0;
+        id = LookupCommand(cmd, cmdLen);
 
-        // Search the command table for a command that matches
-        for (unsigned i = 0; i < NUM_ENTRIES && !handlerFound; i++)
+        if (id == COMMAND_UNKNOWN)
         {
-            const struct CommandProcessorEntry *entry = &ENTRIES[i];
-            if (strncasecmp(args, entry->CommandPrefix, entry->CommandPrefixLen) == 0)
-            {
-                // Strip off the prefix before passing to the command handler
-                args += entry->CommandPrefixLen;
-                success = entry->Handler(args);
-
-                handlerFound = true;
-            }
+            BoardDebugPrint("%s: No matching handler for %s\r\n", __func__, cmd);
+            error = ERROR_UNKNOWN_COMMAND;
         }
+        else
+        {
+            // Strip off the prefix before passing to the command handler
+            const struct CommandProcessorEntry *entry = &ENTRIES[id];
+            success = entry->Handler(&cmd[entry->CommandPrefixLen],
+                                     cmdLen - entry->CommandPrefixLen);
+            error = ERROR_INVALID_ARGUMENT;
+        }
+    }
+
+    LatencyStatsRecord(&CommandStats[id], BoardGetElapsedTimeUs() - startTimeUs, success);
+
+    // Answer failed commands with an error response where the host expects
+    // one, so that it doesn't have to wait out a read timeout. Running out of
+    // room for responses is always reported, since commands were lost.
+    if (!success && (tagged || ErrorResponses || BatchAborted))
+    {
+        ResponseBuf[0] = TAG_FAILURE;
+        ResponseBuf[1] = error;
+        ResponseBufLen = ERROR_RSP_LEN;
+    }
+
+    if (tagged)
+    {
+        // Always answer a tagged command so that the host can retire the tag,
+        // even if the command has no response data or failed
+        memmove(&ResponseBuf[TAG_PREFIX_LEN], ResponseBuf, ResponseBufLen);
+        ResponseBuf[0] = TAG_PREFIX;
+        ResponseBuf[1] = tag;
+        ResponseBufLen += TAG_PREFIX_LEN;
+
+        QueueResponse(true);
+    }
+    else if (ResponseBufLen > 0 && (success || ErrorResponses || BatchAborted))
+    {
+        QueueResponse(false);
+    }
+
+    return success;
+}
+
+/**
+ * Executes every command accumulated in the batch buffer against a single
+ * latched input state, then applies the resulting relay changes at once
+ *
+ * @return Returns true if every command succeeded or false otherwise
+ */
+static bool ExecuteBatch()
+{
+    bool success = true;
+
+    // Untagged responses to the previous batch that the host never fetched
+    // are discarded, just as a single response is overwritten by a new command
+    DiscardUntaggedResponses();
+
+    BatchInputs = BoardReadDigitalInputs();
+    BatchAborted = false;
+    BatchRelaySetMask = 0;
+    BatchRelayClearMask = 0;
+    BatchRelayToggleMask = 0;
+
+    char *cmd = BatchBuf;
+    char *end = &BatchBuf[BatchBufLen];
+    bool isBatch = memchr(BatchBuf, BATCH_DELIMITER, BatchBufLen) != NULL;
+
+    for (;;)
+    {
+        char *delim = memchr(cmd, BATCH_DELIMITER, end - cmd);
+        size_t cmdLen = (delim != NULL ? delim : end) - cmd;
+
+        // Terminate the command in place so handlers see a plain string
+        cmd[cmdLen] = '\0';
+
+        // Empty commands are tolerated between delimiters (e.g. when a batch
+        // is terminated by an empty report), but not on their own. Once the
+        // response queue fills up, the rest of the batch is skipped.
+        if ((cmdLen > 0 || !isBatch) && (BatchAborted || !ProcessSingleCommand(cmd, cmdLen)))
+            success = false;
+
+        if (delim == NULL)
+            break;
+
+        cmd = delim + 1;
+    }
+
+    // Apply all of the relay changes from the batch in a single update, which
+    // leaves the relays the batch didn't touch alone. The relays may also be
+    // opened from interrupt context at the end of a pulse, so a toggle's
+    // read-modify-write must not be interrupted.
+    uint8_t changedRelays = BatchRelaySetMask | BatchRelayClearMask | BatchRelayToggleMask;
 
-        if (!handlerFound)
+    if (BatchRelayToggleMask != 0)
+    {
+        uint32_t state = BoardEnterCritical();
+        BoardWriteRelaysMasked(changedRelays, ReadStagedRelays());
+        BoardExitCritical(state);
+    }
+    else if (changedRelays != 0)
+    {
+        BoardWriteRelaysMasked(changedRelays, BatchRelaySetMask);
+    }
+
+    BatchRelaySetMask = 0;
+    BatchRelayClearMask = 0;
+    BatchRelayToggleMask = 0;
+
+    BatchBufLen = 0;
+
+    return success;
+}
+
+bool AduProtocolProcessCommand(const uint8_t *buf, size_t len)
+{
+    bool success = false;
+    uint32_t startTimeUs = BoardGetElapsedTimeUs();
+
+    // Commands are NULL terminated strings, unless a batch fills the report
+    size_t cmdLen = strnlen((const char*)buf, len);
+
+    if (BatchBufLen + cmdLen > MAX_BATCH_STR_SIZE)
+    {
+        BoardDebugPrint("%s: Batch length too long\r\n", __func__);
+        BatchBufLen = 0;
+
+        // None of the batch is executed, so it gets a single error response
+        DiscardUntaggedResponses();
+        if (ErrorResponses)
         {
-            BoardDebugPrint("%s: No matching handler for %s\r\n", __func__, args);
+            ResponseBuf[0] = TAG_FAILURE;
+            ResponseBuf[1] = ERROR_COMMAND_TOO_LONG;
+            ResponseBufLen = ERROR_RSP_LEN;
+            QueueResponse(false);
         }
     }
+    else
+    {
+        memcpy(&BatchBuf[BatchBufLen], buf, cmdLen);
+        BatchBufLen += cmdLen;
+
+        // A trailing delimiter means that the batch continues in the next
+        // report, so hold off on executing anything until the batch ends
+        if (cmdLen > 0 && buf[cmdLen - 1] == BATCH_DELIMITER)
+            success = true;
+        else
+            success = ExecuteBatch();
+    }
 
     // Handling any command should reset the watchdog timer
     WatchdogKick();
 
+    LatencyStatsRecord(&CommandStats[STATS_SLOT_REPORT], BoardGetElapsedTimeUs() - startTimeUs, success);
+
     return success;
 }
 
@@ -770,6 +1423,42 @@ int AduProtocolGetResponse(uint8_t *buf, size_t len)
 {
     // Copy the response for the last command into the output buffer
     size_t copyLen = len < ResponseBufLen ? len : ResponseBufLen;
-    memcpy(buf, ResponseBuf, ResponseBufLen);
+    memcpy(buf, ResponseBuf, copyLen);
     return copyLen;
-}
\ No newline at end of file
+}
+
+int AduProtocolPopResponse(uint8_t *buf, size_t len)
+{
+    int ret = 0;
+
+    if (ResponseQueueCount > 0)
+    {
+        const struct QueuedResponse *rsp = &ResponseQueue[ResponseQueueHead];
+        size_t copyLen = len < rsp->Len ? len : rsp->Len;
+
+        memcpy(buf, rsp->Data, copyLen);
+        ret = copyLen;
+
+        ResponseQueueHead = (ResponseQueueHead + 1) % RSP_QUEUE_SIZE;
+        ResponseQueueCount--;
+    }
+
+    return ret;
+}
+
+bool AduProtocolReadStats(unsigned slot, struct LatencyStats *stats, bool resetAfterRead)
+{
+    bool success = false;
+
+    if (slot < NUM_STATS_SLOTS)
+    {
+        *stats = CommandStats[slot];
+
+        if (resetAfterRead)
+            LatencyStatsReset(&CommandStats[slot]);
+
+        success = true;
+    }
+
+    return success;
+}
@@ -30,17 +30,31 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef ADU_PROTOCOL_H
 #define ADU_PROTOCOL_H
 
+#include "LatencyStats.h"
+
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
 
 /**
- * Processes the command in the provided buffer.
+ * Processes the command in the provided buffer. The buffer may also contain a
+ * batch of several commands separated by ';' characters (e.g. "SK1;SK2;PK").
+ * A batch may span consecutive reports by ending each report but the last
+ * with a ';'; nothing is executed until the report that ends the batch
+ * arrives. All commands in a batch observe the same, once-latched input
+ * state, and any relay changes they make are applied together in a single
+ * update once the whole batch has been processed.
+ *
+ * Any command may also be tagged by prefixing it with '@' and a tag character
+ * of the host's choosing (e.g. "@7RPA0"). A tagged command always elicits a
+ * response that begins with the same '@' and tag, followed by the normal
+ * response data (if any), or by '?' if the command failed.
  *
  * @param[in] buf The buffer containing the command data
  * @param[in] len The length of the command data
  *
- * @return Returns true on success or false on failure
+ * @return Returns true on success (or when a batch continues in the next
+ *         report) or false if any command failed
  */
 bool AduProtocolProcessCommand(const uint8_t *buf, size_t len);
 
@@ -59,4 +73,35 @@ bool AduProtocolProcessCommand(const uint8_t *buf, size_t len);
  */
 int AduProtocolGetResponse(uint8_t *buf, size_t len);
 
+/**
+ * Fetches and removes the oldest response that has not yet been sent to the
+ * host. Each command in a batch that elicits a response queues a separate
+ * response, in command order, so the host receives them back-to-back as
+ * individual reports. Queued responses to untagged commands are discarded when
+ * a new command or batch is executed, whereas responses to tagged commands
+ * are kept until they have been fetched.
+ *
+ * @param[out] buf The buffer to populate with the response data
+ * @param[in] len The length of the provided buffer
+ *
+ * @return Returns the number of bytes written to the buffer, or zero if there
+ *         are no more queued responses
+ */
+int AduProtocolPopResponse(uint8_t *buf, size_t len);
+
+/**
+ * Reads the execution statistics for one kind of ADU command. Slots 0 through
+ * 16 cover the SK, RK, MK, RPK, PK, RP, PA, PI, RE, RC, DB, WD, ER, SM, RM, TM
+ * and WM commands respectively, slot 17 covers unrecognized commands, and slot
+ * 18 covers the processing of each whole report (which may contain a batch of
+ * commands).
+ *
+ * @param[in] slot The statistics slot to read
+ * @param[out] stats The structure to populate with the statistics
+ * @param[in] resetAfterRead Whether to reset the statistics after reading
+ *
+ * @return Returns true on success or false if the slot is invalid
+ */
+bool AduProtocolReadStats(unsigned slot, struct LatencyStats *stats, bool resetAfterRead);
+
 #endif
\ No newline at end of file
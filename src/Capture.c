@@ -0,0 +1,309 @@
+/*
+Copyright 2021 Frank Jenner
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "Capture.h"
+#include "boards/Board.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef ENABLE_INPUT_CAPTURE
+/** The number of samples to read out of the board at a time */
+#define READ_CHUNK_SIZE 32
+
+/**
+ * The captured runs of identical samples, stored as separate arrays to avoid
+ * padding. The oldest run is at index FirstRun, and the runs wrap around
+ * while waiting for the trigger so that only the latest samples are kept.
+ */
+static uint8_t RunValues[CAPTURE_MAX_RUNS];
+static uint16_t RunLengths[CAPTURE_MAX_RUNS];
+static unsigned FirstRun;
+static unsigned NumRuns;
+
+/** The trigger configuration */
+static uint8_t TriggerMask;
+static uint8_t TriggerValue;
+static uint32_t PreTriggerSamples;
+static uint32_t PostTriggerSamples;
+
+/** The progress of the capture */
+static struct CaptureStatus Status;
+
+/** The number of samples still to be captured after the trigger */
+static uint32_t RemainingSamples;
+
+/** The time of the latest flush */
+static uint32_t LastFlushTimeUs;
+
+/**
+ * Ends the capture, leaving it ready to be read
+ *
+ * @param[in] state The state in which to leave the capture
+ */
+static void Finish(enum CaptureState state)
+{
+    BoardCaptureStop();
+    Status.State = state;
+}
+
+/**
+ * Discards samples from the start of the capture until no more than the
+ * requested pre-trigger samples are left
+ */
+static void TrimToPreTrigger()
+{
+    while (Status.Samples > PreTriggerSamples)
+    {
+        uint32_t excess = Status.Samples - PreTriggerSamples;
+
+        if (RunLengths[FirstRun] > excess)
+        {
+            RunLengths[FirstRun] -= excess;
+            Status.Samples -= excess;
+        }
+        else
+        {
+            Status.Samples -= RunLengths[FirstRun];
+            FirstRun = (FirstRun + 1) % CAPTURE_MAX_RUNS;
+            NumRuns--;
+        }
+    }
+}
+
+/**
+ * Appends a sample to the capture, extending the latest run if possible
+ *
+ * @param[in] sample The state of the inputs
+ *
+ * @return Returns true on success, or false if the capture is full
+ */
+static bool AppendSample(uint8_t sample)
+{
+    bool success = true;
+    unsigned last = (FirstRun + NumRuns - 1) % CAPTURE_MAX_RUNS;
+
+    if (NumRuns > 0 && RunValues[last] == sample && RunLengths[last] < CAPTURE_MAX_RUN_LENGTH)
+    {
+        RunLengths[last]++;
+    }
+    else
+    {
+        // Before the trigger, the oldest samples make way for new ones
+        if (NumRuns == CAPTURE_MAX_RUNS && Status.State == CAPTURE_STATE_ARMED)
+        {
+            Status.Samples -= RunLengths[FirstRun];
+            FirstRun = (FirstRun + 1) % CAPTURE_MAX_RUNS;
+            NumRuns--;
+        }
+
+        if (NumRuns < CAPTURE_MAX_RUNS)
+        {
+            last = (FirstRun + NumRuns++) % CAPTURE_MAX_RUNS;
+            RunValues[last] = sample;
+            RunLengths[last] = 1;
+        }
+        else
+        {
+            success = false;
+        }
+    }
+
+    if (success)
+        Status.Samples++;
+
+    return success;
+}
+
+/**
+ * Adds a sample to the capture and advances the capture state
+ *
+ * @param[in] sample The state of the inputs
+ */
+static void ProcessSample(uint8_t sample)
+{
+    if (Status.State == CAPTURE_STATE_ARMED)
+    {
+        if ((sample & TriggerMask) == TriggerValue)
+        {
+            Status.TriggerSample = Status.Samples;
+            Status.State = CAPTURE_STATE_TRIGGERED;
+            RemainingSamples = PostTriggerSamples;
+            AppendSample(sample);
+        }
+        else
+        {
+            AppendSample(sample);
+            TrimToPreTrigger();
+        }
+    }
+    else if (RemainingSamples > 0)
+    {
+        // A full capture ends early, but keeps its pre-trigger samples
+        if (AppendSample(sample))
+            RemainingSamples--;
+        else
+            RemainingSamples = 0;
+    }
+
+    if (Status.State == CAPTURE_STATE_TRIGGERED && RemainingSamples == 0)
+        Finish(CAPTURE_STATE_DONE);
+}
+
+/**
+ * Capture callback, which compresses the new samples into the capture and
+ * watches for the trigger, from interrupt context
+ */
+static void ReadSamples()
+{
+    uint8_t samples[READ_CHUNK_SIZE];
+    size_t count = READ_CHUNK_SIZE;
+
+    // Drain every sample taken so far, stopping early once the capture ends
+    while (count == READ_CHUNK_SIZE &&
+           (Status.State == CAPTURE_STATE_ARMED || Status.State == CAPTURE_STATE_TRIGGERED))
+    {
+        uint32_t lost;
+
+        count = BoardCaptureRead(samples, READ_CHUNK_SIZE, &lost);
+        Status.LostSamples += lost;
+
+        for (size_t i = 0; i < count && Status.State != CAPTURE_STATE_DONE; i++)
+            ProcessSample(samples[i]);
+    }
+}
+
+void CaptureInit()
+{
+    CaptureTriggerSet(0, 0, 0, 0);
+    Status.State = CAPTURE_STATE_IDLE;
+    Status.Samples = 0;
+    Status.TriggerSample = 0;
+    Status.LostSamples = 0;
+    NumRuns = 0;
+}
+
+void CaptureTriggerSet(uint8_t mask, uint8_t value, uint32_t preSamples, uint32_t postSamples)
+{
+    uint32_t state = BoardEnterCritical();
+
+    TriggerMask = mask;
+    TriggerValue = value & mask;
+    PreTriggerSamples = preSamples;
+    PostTriggerSamples = postSamples;
+
+    BoardExitCritical(state);
+}
+
+bool CaptureStart(uint32_t sampleRateHz)
+{
+    CaptureStop();
+
+    FirstRun = 0;
+    NumRuns = 0;
+    Status.Samples = 0;
+    Status.TriggerSample = 0;
+    Status.LostSamples = 0;
+    LastFlushTimeUs = BoardGetElapsedTimeUs();
+
+    // The samples are read out from interrupt context as soon as sampling
+    // starts, so the capture must already be armed
+    Status.State = CAPTURE_STATE_ARMED;
+
+    uint32_t state = BoardEnterCritical();
+    bool success = BoardCaptureStart(sampleRateHz, ReadSamples);
+
+    if (!success)
+        Status.State = CAPTURE_STATE_IDLE;
+
+    BoardExitCritical(state);
+
+    return success;
+}
+
+void CaptureStop()
+{
+    uint32_t state = BoardEnterCritical();
+
+    if (Status.State == CAPTURE_STATE_ARMED || Status.State == CAPTURE_STATE_TRIGGERED)
+        Finish(CAPTURE_STATE_IDLE);
+
+    BoardExitCritical(state);
+}
+
+void CaptureTask()
+{
+    if ((Status.State == CAPTURE_STATE_ARMED || Status.State == CAPTURE_STATE_TRIGGERED) &&
+        CaptureTaskDelayUs() == 0)
+    {
+        LastFlushTimeUs = BoardGetElapsedTimeUs();
+        BoardCaptureFlush();
+    }
+}
+
+uint32_t CaptureTaskDelayUs()
+{
+    uint32_t delayUs = UINT32_MAX;
+
+    if (Status.State == CAPTURE_STATE_ARMED || Status.State == CAPTURE_STATE_TRIGGERED)
+    {
+        uint32_t elapsedUs = BoardGetElapsedTimeUs() - LastFlushTimeUs;
+        delayUs = elapsedUs >= CAPTURE_FLUSH_INTERVAL_US ? 0 : CAPTURE_FLUSH_INTERVAL_US - elapsedUs;
+    }
+
+    return delayUs;
+}
+
+void CaptureStatusGet(struct CaptureStatus *status)
+{
+    uint32_t state = BoardEnterCritical();
+
+    *status = Status;
+    status->Runs = NumRuns;
+
+    BoardExitCritical(state);
+}
+
+size_t CaptureReadRuns(unsigned first, uint8_t *values, uint16_t *lengths, size_t maxRuns)
+{
+    size_t count = 0;
+
+    if (Status.State == CAPTURE_STATE_IDLE || Status.State == CAPTURE_STATE_DONE)
+    {
+        for (unsigned i = first; i < NumRuns && count < maxRuns; i++)
+        {
+            values[count] = RunValues[(FirstRun + i) % CAPTURE_MAX_RUNS];
+            lengths[count] = RunLengths[(FirstRun + i) % CAPTURE_MAX_RUNS];
+            count++;
+        }
+    }
+
+    return count;
+}
+#endif
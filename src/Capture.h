@@ -0,0 +1,152 @@
+/*
+Copyright 2021 Frank Jenner
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** The maximum number of runs of identical samples in a capture */
+#define CAPTURE_MAX_RUNS 256
+
+/** The longest run of identical samples stored as a single run */
+#define CAPTURE_MAX_RUN_LENGTH UINT16_MAX
+
+/**
+ * How often CaptureTask() flushes the samples that haven't yet filled half of
+ * the board's ring buffer, so that slow captures still make progress
+ */
+#define CAPTURE_FLUSH_INTERVAL_US 1000
+
+/** The states of a capture */
+enum CaptureState
+{
+    /** No capture is in progress (any previous capture can still be read) */
+    CAPTURE_STATE_IDLE,
+
+    /** Sampling the inputs and waiting for the trigger pattern */
+    CAPTURE_STATE_ARMED,
+
+    /** Sampling the inputs after the trigger */
+    CAPTURE_STATE_TRIGGERED,
+
+    /** The capture has finished and can be read */
+    CAPTURE_STATE_DONE
+};
+
+/** The progress of a capture */
+struct CaptureStatus
+{
+    enum CaptureState State;
+
+    /** The number of samples captured */
+    uint32_t Samples;
+
+    /** The index of the sample that matched the trigger pattern */
+    uint32_t TriggerSample;
+
+    /** The number of samples lost because they weren't read out in time */
+    uint32_t LostSamples;
+
+    /** The number of runs the samples were compressed into */
+    uint16_t Runs;
+};
+
+/**
+ * Initialize the capture module with no capture in progress and a trigger
+ * that matches immediately
+ */
+void CaptureInit();
+
+/**
+ * Configures the trigger for subsequent captures. The capture triggers on the
+ * first sample for which the inputs selected by @p mask have the states in
+ * @p value, and keeps up to @p preSamples samples from before the trigger.
+ *
+ * @param[in] mask The inputs to compare against the trigger pattern
+ * @param[in] value The trigger pattern
+ * @param[in] preSamples The number of samples to keep from before the trigger
+ * @param[in] postSamples The number of samples to capture after the trigger
+ */
+void CaptureTriggerSet(uint8_t mask, uint8_t value, uint32_t preSamples, uint32_t postSamples);
+
+/**
+ * Starts sampling all of the digital inputs at a fixed rate, discarding any
+ * previous capture
+ *
+ * @param[in] sampleRateHz The sample rate
+ *
+ * @return Returns true on success, or false if the sample rate is unsupported
+ */
+bool CaptureStart(uint32_t sampleRateHz);
+
+/**
+ * Stops the capture in progress, if any, keeping what has been captured
+ */
+void CaptureStop();
+
+/**
+ * Should be called periodically while capturing. The samples are compressed
+ * into the capture from interrupt context whenever the board's ring buffer
+ * fills halfway, so this only flushes the remaining samples every so often,
+ * which keeps slow captures progressing.
+ */
+void CaptureTask();
+
+/**
+ * Gets how long CaptureTask() can go without being called before the next
+ * flush is due
+ *
+ * @return Returns the delay in microseconds, or UINT32_MAX if the task has no
+ *         pending work
+ */
+uint32_t CaptureTaskDelayUs();
+
+/**
+ * Gets the progress of the capture
+ *
+ * @param[out] status The structure to populate with the progress
+ */
+void CaptureStatusGet(struct CaptureStatus *status);
+
+/**
+ * Reads runs of identical samples from a finished or stopped capture
+ *
+ * @param[in] first The index of the first run to read
+ * @param[out] values The input states of each run
+ * @param[out] lengths The number of samples in each run
+ * @param[in] maxRuns The maximum number of runs to read
+ *
+ * @return The number of runs read, which is zero while capturing
+ */
+size_t CaptureReadRuns(unsigned first, uint8_t *values, uint16_t *lengths, size_t maxRuns);
+
+#endif
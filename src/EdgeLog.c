@@ -0,0 +1,122 @@
+/*
+Copyright 2021 Frank Jenner
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "EdgeLog.h"
+#include "EventCounter.h"
+#include "boards/Board.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Flag set in a stored record's input byte for a rising edge */
+#define RECORD_RISING 0x80
+
+/**
+ * The records, stored as separate arrays to avoid padding. The oldest record
+ * is at index Tail, and the next one is written at index Head (both modulo
+ * EDGE_LOG_SIZE).
+ */
+static uint32_t RecordTimesUs[EDGE_LOG_SIZE];
+static uint8_t RecordInputs[EDGE_LOG_SIZE];
+static unsigned Head;
+static unsigned Tail;
+
+/** The number of edges dropped because the log was full */
+static uint32_t Dropped;
+
+/** The inputs whose edges are logged */
+static uint8_t LoggedInputs;
+
+void EdgeLogInit()
+{
+    EdgeLogInputsSet(0);
+}
+
+void EdgeLogInputsSet(uint8_t inputs)
+{
+    uint32_t state = BoardEnterCritical();
+
+    LoggedInputs = inputs;
+    Head = 0;
+    Tail = 0;
+    Dropped = 0;
+    EventCounterTrackInputs(EVENT_COUNTER_TRACKER_EDGE_LOG, inputs);
+
+    BoardExitCritical(state);
+}
+
+uint8_t EdgeLogInputsGet()
+{
+    return LoggedInputs;
+}
+
+void EdgeLogRecord(unsigned input, bool rising, uint32_t timeUs)
+{
+    if ((LoggedInputs & (1 << input)) != 0)
+    {
+        uint32_t state = BoardEnterCritical();
+
+        if (Head - Tail == EDGE_LOG_SIZE)
+        {
+            Dropped++;
+        }
+        else
+        {
+            unsigned index = Head++ % EDGE_LOG_SIZE;
+
+            RecordTimesUs[index] = timeUs;
+            RecordInputs[index] = input | (rising ? RECORD_RISING : 0);
+        }
+
+        BoardExitCritical(state);
+    }
+}
+
+size_t EdgeLogRead(struct EdgeLogEntry *entries, size_t maxEntries, uint32_t *dropped)
+{
+    size_t count = 0;
+    uint32_t state = BoardEnterCritical();
+
+    while (count < maxEntries && Tail != Head)
+    {
+        unsigned index = Tail++ % EDGE_LOG_SIZE;
+
+        entries[count].TimeUs = RecordTimesUs[index];
+        entries[count].Input = RecordInputs[index] & ~RECORD_RISING;
+        entries[count].Rising = (RecordInputs[index] & RECORD_RISING) != 0;
+        count++;
+    }
+
+    *dropped = Dropped;
+    Dropped = 0;
+
+    BoardExitCritical(state);
+
+    return count;
+}
@@ -0,0 +1,98 @@
+/*
+Copyright 2021 Frank Jenner
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef EDGE_LOG_H
+#define EDGE_LOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** The number of records the edge log can hold (a power of 2) */
+#define EDGE_LOG_SIZE 64
+
+/** A debounced edge on one of the digital inputs */
+struct EdgeLogEntry
+{
+    /** The time of the edge, in the same time base as BoardGetElapsedTimeUs() */
+    uint32_t TimeUs;
+
+    /** The index of the input */
+    uint8_t Input;
+
+    /** True for a rising edge, or false for a falling edge */
+    bool Rising;
+};
+
+/**
+ * Initialize the edge log with no inputs selected
+ */
+void EdgeLogInit();
+
+/**
+ * Selects the inputs whose edges are logged, and discards any records and
+ * drop count from the previous selection. Falling edges are detected on the
+ * selected inputs in addition to rising edges.
+ *
+ * @param[in] inputs The inputs to log, using the same bit layout as
+ *                   BoardReadDigitalInputs()
+ */
+void EdgeLogInputsSet(uint8_t inputs);
+
+/**
+ * Gets the inputs whose edges are logged
+ *
+ * @return The bit mask of logged inputs
+ */
+uint8_t EdgeLogInputsGet();
+
+/**
+ * Appends an edge to the log if its input is selected. If the log is full,
+ * the edge is dropped and counted instead. May be called from interrupt
+ * context.
+ *
+ * @param[in] input The index of the input
+ * @param[in] rising True for a rising edge, or false for a falling edge
+ * @param[in] timeUs The time of the edge
+ */
+void EdgeLogRecord(unsigned input, bool rising, uint32_t timeUs);
+
+/**
+ * Removes the oldest records from the log
+ *
+ * @param[out] entries The array to populate with the records, oldest first
+ * @param[in] maxEntries The maximum number of records to remove
+ * @param[out] dropped The number of edges dropped because the log was full
+ *                     since the previous read
+ *
+ * @return The number of records removed
+ */
+size_t EdgeLogRead(struct EdgeLogEntry *entries, size_t maxEntries, uint32_t *dropped);
+
+#endif
@@ -28,103 +28,413 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "EventCounter.h"
+#include "EdgeLog.h"
 #include "boards/Board.h"
 
 /** Use 1ms debounce period by default */
 #define DEFAULT_DEBOUNCE_TIME_US 1000
 
-enum DebounceState
+/*
+ * The debounce state of all eight inputs is kept in bit masks (one bit per
+ * input, using the same layout as BoardReadDigitalInputs()), so that each
+ * sample or batch of edges is classified for every input at once with a few
+ * bitwise operations. Only the inputs that actually changed are then visited
+ * individually to count and log their edges.
+ */
+
+/** The number of rising edges counted on each input */
+static uint32_t Counts[EVENT_COUNTER_NUM_COUNTERS];
+
+/** The time of the last accepted edge on each input */
+static uint32_t EdgeTimesUs[EVENT_COUNTER_NUM_COUNTERS];
+
+/** The debounce time for each input */
+static uint32_t DebounceTimesUs[EVENT_COUNTER_NUM_COUNTERS];
+
+/** The debounced state of the inputs, as of their last accepted edges */
+static uint8_t AssertedInputs;
+
+/** The inputs still within the debounce time of their last accepted edge */
+static uint8_t SettlingInputs;
+
+/**
+ * The time at which to next check for inputs that have finished settling. This
+ * is never later than the earliest expiry among SettlingInputs, but may be
+ * earlier.
+ */
+static uint32_t NextRetireTimeUs;
+
+/** The inputs tracked by each module */
+static uint8_t TrackedInputs[EVENT_COUNTER_NUM_TRACKERS];
+
+#ifdef ENABLE_EVENT_COUNTER_INTERRUPTS
+/** The time of the last edge on each input, including any ignored as bounce */
+static uint32_t LastEdgeTimesUs[EVENT_COUNTER_NUM_COUNTERS];
+#endif
+
+/**
+ * Starts the debounce period of an input following an accepted edge
+ *
+ * @param[in] index The index of the input
+ * @param[in] timeUs The time of the accepted edge
+ */
+static void StartSettling(unsigned index, uint32_t timeUs)
+{
+    uint32_t expiryUs = timeUs + DebounceTimesUs[index] + 1;
+
+    if (SettlingInputs == 0 || (int32_t)(expiryUs - NextRetireTimeUs) < 0)
+        NextRetireTimeUs = expiryUs;
+
+    EdgeTimesUs[index] = timeUs;
+    SettlingInputs |= 1 << index;
+}
+
+/**
+ * Ends the debounce period of every settling input whose debounce time has
+ * expired, and works out when the next one expires
+ *
+ * @param[in] timeUs The current time
+ *
+ * @return Returns the inputs that finished settling
+ */
+static uint8_t RetireSettledInputs(uint32_t timeUs)
+{
+    uint8_t settled = 0;
+    uint8_t remaining = SettlingInputs;
+    bool first = true;
+
+    for (unsigned i = 0; remaining != 0; i++, remaining >>= 1)
+    {
+        if ((remaining & 1) != 0)
+        {
+            uint32_t expiryUs = EdgeTimesUs[i] + DebounceTimesUs[i] + 1;
+
+            if (timeUs - EdgeTimesUs[i] > DebounceTimesUs[i])
+            {
+                settled |= 1 << i;
+            }
+            else if (first || (int32_t)(expiryUs - NextRetireTimeUs) < 0)
+            {
+                NextRetireTimeUs = expiryUs;
+                first = false;
+            }
+        }
+    }
+
+    SettlingInputs &= ~settled;
+
+    return settled;
+}
+
+/**
+ * Counts and logs edges that have been accepted on a set of inputs, all at
+ * the same time
+ *
+ * @param[in] risingEdges The inputs on which a rising edge was accepted
+ * @param[in] fallingEdges The inputs on which a falling edge was accepted
+ * @param[in] timeUs The time of the edges
+ */
+static void RecordEdges(uint8_t risingEdges, uint8_t fallingEdges, uint32_t timeUs)
+{
+    uint8_t edges = risingEdges | fallingEdges;
+
+    for (unsigned i = 0; edges != 0; i++, edges >>= 1)
+    {
+        if ((edges & 1) != 0)
+        {
+            bool rising = (risingEdges & (1 << i)) != 0;
+
+            if (rising)
+                Counts[i]++;
+
+            EdgeLogRecord(i, rising, timeUs);
+        }
+    }
+}
+
+#ifdef ENABLE_EVENT_COUNTER_INTERRUPTS
+/**
+ * Debounces a single edge on one input. An edge is accepted unless it arrives
+ * within the debounce time of the last accepted edge on the same input, in
+ * which case it is contact bounce. Accepted rising edges are counted, and
+ * accepted edges are logged. (There is no need for a separate "waiting for
+ * falling edge" state as in the polled implementation, since a rising edge
+ * can only follow a falling edge.)
+ *
+ * @param[in] index The index of the input
+ * @param[in] rising True for a rising edge, or false for a falling edge
+ * @param[in] timeUs The time at which the edge was detected
+ */
+static void HandleEdge(unsigned index, bool rising, uint32_t timeUs)
 {
-    DEBOUNCE_STATE_WAITING_FOR_RISING_EDGE,
-    DEBOUNCE_STATE_SETTLING,
-    DEBOUNCE_STATE_WAITING_FOR_FALLING_EDGE,
-};
+    uint8_t mask = 1 << index;
+
+    LastEdgeTimesUs[index] = timeUs;
+
+    // Falling edges are only detected on tracked inputs, so a rising edge is
+    // accepted even if the falling edge before it went unseen
+    if (((SettlingInputs & mask) == 0 ||
+         timeUs - EdgeTimesUs[index] > DebounceTimesUs[index]) &&
+        (rising || (AssertedInputs & mask) != 0))
+    {
+        if (rising)
+        {
+            AssertedInputs |= mask;
+            RecordEdges(mask, 0, timeUs);
+        }
+        else
+        {
+            AssertedInputs &= ~mask;
+            RecordEdges(0, mask, timeUs);
+        }
+
+        StartSettling(index, timeUs);
+    }
+}
 
-struct EventCounter
+/**
+ * Debounces the edges reported by the input edge interrupts. This runs in
+ * interrupt context, so the edge timestamps are accurate regardless of how
+ * long the main loop takes.
+ *
+ * @param[in] risingEdges The inputs on which a rising edge was detected
+ * @param[in] fallingEdges The inputs on which a falling edge was detected
+ * @param[in] timeUs The time at which the edges were detected
+ */
+static void HandleInputEdges(uint8_t risingEdges, uint8_t fallingEdges, uint32_t timeUs)
 {
-    enum DebounceState State;
-    uint32_t RisingEdgeTime;
-    uint16_t Count;
-};
+    uint8_t edges = risingEdges | fallingEdges;
 
-/** Event counters for each of the digital inputs */
-static struct EventCounter Counters[EVENT_COUNTER_NUM_COUNTERS];
+    for (unsigned i = 0; edges != 0; i++, edges >>= 1)
+    {
+        if ((edges & 1) != 0)
+        {
+            bool rising = (risingEdges & (1 << i)) != 0;
+            bool falling = (fallingEdges & (1 << i)) != 0;
+            bool fallingFirst = (AssertedInputs & (1 << i)) != 0;
 
-/** The debounce time for the input pins */
-static uint32_t DebounceTimeUs;
+            // When an input pulsed too briefly to see each edge separately,
+            // the edge away from the debounced state came first
+            if (falling && fallingFirst)
+                HandleEdge(i, false, timeUs);
+            if (rising)
+                HandleEdge(i, true, timeUs);
+            if (falling && !fallingFirst)
+                HandleEdge(i, false, timeUs);
+        }
+    }
+}
+#endif
 
 void EventCounterInit()
 {
     // Initialize all of the event counters to zero
     for (unsigned i = 0; i < EVENT_COUNTER_NUM_COUNTERS; i++)
     {
-        Counters[i].Count = 0;
-        Counters[i].State = DEBOUNCE_STATE_WAITING_FOR_RISING_EDGE;
+        Counts[i] = 0;
+        DebounceTimesUs[i] = DEFAULT_DEBOUNCE_TIME_US;
     }
 
-    DebounceTimeUs = DEFAULT_DEBOUNCE_TIME_US;
+    AssertedInputs = 0;
+    SettlingInputs = 0;
+
+    for (unsigned i = 0; i < EVENT_COUNTER_NUM_TRACKERS; i++)
+        TrackedInputs[i] = 0;
+    BoardInputFallingEdgesSet(0);
+
+#ifdef ENABLE_EVENT_COUNTER_INTERRUPTS
+    BoardInputEdgeCallbackSet(HandleInputEdges);
+#endif
 }
 
+#ifdef ENABLE_EVENT_COUNTER_INTERRUPTS
+void EventCounterTask()
+{
+    // Edges are counted from interrupt context, so all that's left to do here
+    // is to retire expired debounce periods. Otherwise, after the 32-bit
+    // microsecond time base rolls over (about every 71 minutes), an edge on an
+    // idle input could appear to be within the debounce time of an old one.
+    uint32_t state = BoardEnterCritical();
+    uint32_t currentTimeUs = BoardGetElapsedTimeUs();
+
+    if (SettlingInputs != 0 && (int32_t)(currentTimeUs - NextRetireTimeUs) >= 0)
+    {
+        uint8_t settled = RetireSettledInputs(currentTimeUs);
+
+        // If an input settled in the opposite state, the last edge that was
+        // ignored as contact bounce was in fact a real edge. It's accepted
+        // like any other, so it starts a new debounce period of its own.
+        uint8_t missed = settled & (BoardReadDigitalInputs() ^ AssertedInputs);
+
+        for (unsigned i = 0; missed != 0; i++, missed >>= 1)
+        {
+            if ((missed & 1) != 0)
+                HandleEdge(i, (AssertedInputs & (1 << i)) == 0, LastEdgeTimesUs[i]);
+        }
+    }
+
+    BoardExitCritical(state);
+}
+
+uint32_t EventCounterTaskDelayUs()
+{
+    uint32_t delayUs = UINT32_MAX;
+    uint32_t state = BoardEnterCritical();
+
+    // Wake up in time to retire the earliest expiring debounce period
+    if (SettlingInputs != 0)
+    {
+        int32_t untilUs = NextRetireTimeUs - BoardGetElapsedTimeUs();
+
+        delayUs = untilUs > 0 ? (uint32_t)untilUs : 0;
+    }
+
+    BoardExitCritical(state);
+
+    return delayUs;
+}
+#else
 void EventCounterTask()
 {
     uint32_t sampleTime = BoardGetElapsedTimeUs();
     uint8_t inputs = BoardReadDigitalInputs();
 
-    for (unsigned i = 0; i < EVENT_COUNTER_NUM_COUNTERS; i++)
+    // Inputs whose debounce time has expired go back to waiting for an edge
+    if (SettlingInputs != 0 && (int32_t)(sampleTime - NextRetireTimeUs) >= 0)
+        RetireSettledInputs(sampleTime);
+
+    // A rising edge is accepted as soon as a deasserted input reads high
+    // (only rising edges start a debounce period here, so such an input can't
+    // be settling), and a falling edge as soon as a settled input reads low
+    uint8_t risingEdges = inputs & ~AssertedInputs;
+    uint8_t fallingEdges = ~inputs & AssertedInputs & ~SettlingInputs;
+
+    if ((risingEdges | fallingEdges) != 0)
     {
-        struct EventCounter *counter = &Counters[i];
-        bool inputAsserted = (inputs & (1 << i)) != 0;
+        AssertedInputs = (AssertedInputs | risingEdges) & ~fallingEdges;
+        RecordEdges(risingEdges, fallingEdges, sampleTime);
 
-        switch (counter->State)
+        for (unsigned i = 0; risingEdges != 0; i++, risingEdges >>= 1)
         {
-            case DEBOUNCE_STATE_WAITING_FOR_RISING_EDGE:
-                if (inputAsserted)
-                {
-                    counter->Count++;
-                    counter->RisingEdgeTime = sampleTime;
-                    counter->State = DEBOUNCE_STATE_SETTLING;
-                }
-                break;
-
-            case DEBOUNCE_STATE_SETTLING:
-                // Don't change state until the debounce timer has elapsed
-                if (sampleTime - counter->RisingEdgeTime > DebounceTimeUs)
-                {
-                    if (inputAsserted)
-                        counter->State = DEBOUNCE_STATE_WAITING_FOR_FALLING_EDGE;
-                    else
-                        counter->State = DEBOUNCE_STATE_WAITING_FOR_RISING_EDGE;
-                }
-                break;
-
-            case DEBOUNCE_STATE_WAITING_FOR_FALLING_EDGE:
-                if (!inputAsserted)
-                    counter->State = DEBOUNCE_STATE_WAITING_FOR_RISING_EDGE;
-                break;
+            if ((risingEdges & 1) != 0)
+                StartSettling(i, sampleTime);
         }
     }
 }
 
-uint16_t EventCounterRead(uint8_t index, bool resetAfterRead)
+uint32_t EventCounterTaskDelayUs()
+{
+    // Edges can only be detected by sampling the inputs as often as possible
+    return 0;
+}
+#endif
+
+uint32_t EventCounterRead(uint8_t index, bool resetAfterRead)
 {
-    uint16_t ret = 0;
+    uint32_t ret = 0;
 
     if (index < EVENT_COUNTER_NUM_COUNTERS)
     {
-        ret = Counters[index].Count;
+        // The count may be updated from the edge interrupt, so the read and
+        // the reset must happen without an edge slipping in between
+        uint32_t state = BoardEnterCritical();
+
+        ret = Counts[index];
         if (resetAfterRead)
-            Counters[index].Count = 0;
+            Counts[index] = 0;
+
+        BoardExitCritical(state);
     }
 
     return ret;
 }
 
-void EventCounterDebounceTimeSet(uint32_t debounceTimeUs)
+void EventCounterReadAll(uint32_t counts[EVENT_COUNTER_NUM_COUNTERS], bool resetAfterRead)
 {
-    DebounceTimeUs = debounceTimeUs;
+    // Capture (and reset) every counter at the same instant
+    uint32_t state = BoardEnterCritical();
+
+    for (unsigned i = 0; i < EVENT_COUNTER_NUM_COUNTERS; i++)
+    {
+        counts[i] = Counts[i];
+        if (resetAfterRead)
+            Counts[i] = 0;
+    }
+
+    BoardExitCritical(state);
 }
 
-uint32_t EventCounterDebounceTimeGet()
+bool EventCounterDebounceTimeSet(uint8_t inputs, uint32_t debounceTimeUs)
 {
-    return DebounceTimeUs;
+    bool success = false;
+
+    if (debounceTimeUs <= EVENT_COUNTER_MAX_DEBOUNCE_TIME_US)
+    {
+        uint32_t state = BoardEnterCritical();
+
+        for (unsigned i = 0; i < EVENT_COUNTER_NUM_COUNTERS; i++)
+        {
+            if ((inputs & (1 << i)) != 0)
+                DebounceTimesUs[i] = debounceTimeUs;
+        }
+
+        // A shorter debounce time may expire before the next scheduled check
+        NextRetireTimeUs = BoardGetElapsedTimeUs();
+
+        BoardExitCritical(state);
+        success = true;
+    }
+
+    return success;
+}
+
+uint32_t EventCounterDebounceTimeGet(uint8_t index)
+{
+    uint32_t ret = 0;
+
+    if (index < EVENT_COUNTER_NUM_COUNTERS)
+        ret = DebounceTimesUs[index];
+
+    return ret;
+}
+
+void EventCounterTrackInputs(enum EventCounterTracker tracker, uint8_t inputs)
+{
+    uint8_t allInputs = 0;
+    uint32_t state = BoardEnterCritical();
+
+    TrackedInputs[tracker] = inputs;
+    for (unsigned i = 0; i < EVENT_COUNTER_NUM_TRACKERS; i++)
+        allInputs |= TrackedInputs[i];
+
+    BoardInputFallingEdgesSet(allInputs);
+
+#ifdef ENABLE_EVENT_COUNTER_INTERRUPTS
+    // An input that wasn't tracked may have fallen unseen, so start from its
+    // current state (unless it's still settling, in which case the state is
+    // checked once the debounce time expires)
+    uint8_t resync = allInputs & ~SettlingInputs;
+
+    AssertedInputs = (AssertedInputs & ~resync) | (BoardReadDigitalInputs() & resync);
+#endif
+
+    BoardExitCritical(state);
+}
+
+uint8_t EventCounterDebouncedInputsGet()
+{
+    return AssertedInputs;
+}
+
+uint8_t EventCounterTrackedInputsGet()
+{
+    uint8_t allInputs = EVENT_COUNTER_ALL_INPUTS;
+
+#ifdef ENABLE_EVENT_COUNTER_INTERRUPTS
+    allInputs = 0;
+    for (unsigned i = 0; i < EVENT_COUNTER_NUM_TRACKERS; i++)
+        allInputs |= TrackedInputs[i];
+#endif
+
+    return allInputs;
 }
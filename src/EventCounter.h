@@ -36,6 +36,22 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 /** There is an event counter for each of the digital inputs */
 #define EVENT_COUNTER_NUM_COUNTERS 8
 
+/** The longest supported debounce time, in microseconds */
+#define EVENT_COUNTER_MAX_DEBOUNCE_TIME_US 1000000
+
+/** Selects all of the inputs in EventCounterDebounceTimeSet() */
+#define EVENT_COUNTER_ALL_INPUTS 0xff
+
+/** The modules that track the debounced state of some of the inputs */
+enum EventCounterTracker
+{
+    EVENT_COUNTER_TRACKER_EDGE_LOG,
+    EVENT_COUNTER_TRACKER_INPUT_NOTIFY,
+    EVENT_COUNTER_TRACKER_STREAMING,
+
+    EVENT_COUNTER_NUM_TRACKERS
+};
+
 /**
  * Initializes the event counter code, including resetting the event counters
  * and setting the default debounce configuration
@@ -43,13 +59,26 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 void EventCounterInit();
 
 /**
- * Performs debouncing and records event counts
+ * Performs debouncing, records event counts, and passes the debounced edges
+ * to the edge log. When built with ENABLE_EVENT_COUNTER_INTERRUPTS, edges are
+ * instead debounced and timestamped from the input edge interrupts, and this
+ * task only performs housekeeping of the debounce state.
  */
 void EventCounterTask();
 
+/**
+ * Gets how long EventCounterTask() can go without being called before it has
+ * work to do. When counting by polling, the inputs must be sampled
+ * continuously, so this is always zero.
+ *
+ * @return Returns the delay in microseconds, or UINT32_MAX if the task has no
+ *         pending work
+ */
+uint32_t EventCounterTaskDelayUs();
+
 /**
  * Gets the current count of the selected event counter, optionally clearing
- * the count atomically. The count is a 16-bit value that wraps back to zero
+ * the count atomically. The count is a 32-bit value that wraps back to zero
  * on overflow.
  *
  * @param[in] index The index of the event counter whose count to return
@@ -57,23 +86,71 @@ void EventCounterTask();
  *
  * @return Returns the count for this event
  */
-uint16_t EventCounterRead(uint8_t index, bool resetAfterRead);
+uint32_t EventCounterRead(uint8_t index, bool resetAfterRead);
+
+/**
+ * Gets the current counts of all of the event counters, captured at the same
+ * instant, optionally clearing all of the counts atomically
+ *
+ * @param[out] counts The array to populate with the counts, counter 0 first
+ * @param[in] resetAfterRead If true, resets every counter after reading
+ */
+void EventCounterReadAll(uint32_t counts[EVENT_COUNTER_NUM_COUNTERS], bool resetAfterRead);
 
 /**
- * Sets the debounce time used for the event counters. When a rising edge is
- * detected from an idle state, the debounce timer starts. Any additional
- * rising edges that occur before the debounce time elapses do not contribute
- * to the event count.
+ * Sets the debounce time of some of the inputs. When an edge is accepted on
+ * an input, the debounce timer starts. Any additional rising edges that occur
+ * before the debounce time elapses do not contribute to the event count. On
+ * inputs selected with EventCounterTrackInputs(), falling edges are debounced
+ * in the same way.
  *
+ * @param[in] inputs The inputs whose debounce time to set, using the same bit
+ *                   layout as BoardReadDigitalInputs()
  * @param[in] debounceTimeUs The debounce time, in microseconds
+ *
+ * @return Returns true on success, or false if the debounce time is longer
+ *         than EVENT_COUNTER_MAX_DEBOUNCE_TIME_US
+ */
+bool EventCounterDebounceTimeSet(uint8_t inputs, uint32_t debounceTimeUs);
+
+/**
+ * Gets the debounce time of an input
+ *
+ * @param[in] index The index of the input
+ *
+ * @return The debounce time, in microseconds, or zero if the index is invalid
+ */
+uint32_t EventCounterDebounceTimeGet(uint8_t index);
+
+/**
+ * Selects the inputs whose debounced state a module needs to track. Falling
+ * edges are detected and debounced on the inputs selected by any module, in
+ * addition to the rising edges that are always counted.
+ *
+ * @param[in] tracker The module making the selection
+ * @param[in] inputs The inputs to track, using the same bit layout as
+ *                   BoardReadDigitalInputs()
+ */
+void EventCounterTrackInputs(enum EventCounterTracker tracker, uint8_t inputs);
+
+/**
+ * Gets the debounced state of the inputs. This is only kept up to date for
+ * the inputs selected with EventCounterTrackInputs(), unless counting by
+ * polling.
+ *
+ * @return The debounced state of the inputs, using the same bit layout as
+ *         BoardReadDigitalInputs()
  */
-void EventCounterDebounceTimeSet(uint32_t debounceTimeUs);
+uint8_t EventCounterDebouncedInputsGet();
 
 /**
- * Gets the debounce time used for the event counters
+ * Gets the inputs whose debounced state is being kept up to date, i.e. those
+ * selected by any module with EventCounterTrackInputs(), or all of them when
+ * counting by polling
  *
- * @return The debounce time, in microseconds
+ * @return The tracked inputs, using the same bit layout as
+ *         BoardReadDigitalInputs()
  */
-uint32_t EventCounterDebounceTimeGet();
+uint8_t EventCounterTrackedInputsGet();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,688 @@
+/*
+Copyright 2021 Frank Jenner
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "ExtProtocol.h"
+#include "EventCounter.h"
+#include "Watchdog.h"
+#include "Profiler.h"
+#include "RelayPulse.h"
+#include "Sequencer.h"
+#include "EdgeLog.h"
+#include "Capture.h"
+#include "AduProtocol.h"
+#include "Streaming.h"
+#include "Scheduler.h"
+#include "Usb.h"
+#include "boards/Board.h"
+
+#include <string.h>
+
+/** The size of a set of latency statistics in a response */
+#define LATENCY_STATS_RESPONSE_SIZE (4 + 4 + 2 + 2 + 2 * LATENCY_STATS_NUM_BUCKETS)
+
+// The statistics follow the opcode, status and slot (or histogram) bytes
+#if 3 + LATENCY_STATS_RESPONSE_SIZE > EXT_PROTOCOL_MAX_RESPONSE_SIZE
+#error "Latency statistics must fit in an extended command response"
+#endif
+
+/** Buffer for storing the response to the latest command */
+static uint8_t ResponseBuf[EXT_PROTOCOL_MAX_RESPONSE_SIZE];
+
+/** The size of the response in the buffer, or zero if it has been taken */
+static size_t ResponseBufLen;
+
+/**
+ * Appends a little-endian value to the response buffer
+ *
+ * @param[in] value The value to append
+ * @param[in] numBytes The number of bytes of @p value to append
+ */
+static void AppendResponse(uint32_t value, unsigned numBytes)
+{
+    for (unsigned i = 0; i < numBytes; i++)
+    {
+        ResponseBuf[ResponseBufLen++] = value & 0xff;
+        value >>= 8;
+    }
+}
+
+/**
+ * Appends a set of latency statistics to the response buffer
+ *
+ * @param[in] stats The statistics to append
+ */
+static void AppendLatencyStats(const struct LatencyStats *stats)
+{
+    AppendResponse(stats->Count, sizeof(stats->Count));
+    AppendResponse(stats->Errors, sizeof(stats->Errors));
+    AppendResponse(stats->MinUs, sizeof(stats->MinUs));
+    AppendResponse(stats->MaxUs, sizeof(stats->MaxUs));
+
+    for (unsigned i = 0; i < LATENCY_STATS_NUM_BUCKETS; i++)
+        AppendResponse(stats->Buckets[i], sizeof(stats->Buckets[i]));
+}
+
+/**
+ * Handler for the EXT_OPCODE_READ_COUNTERS command
+ *
+ * @param[in] args The command arguments following the opcode
+ * @param[in] len The number of argument bytes
+ *
+ * @return Returns the EXT_STATUS_* status of the command
+ */
+static uint8_t HandlerReadCounters(const uint8_t *args, size_t len)
+{
+    uint32_t counts[EVENT_COUNTER_NUM_COUNTERS];
+
+    EventCounterReadAll(counts, (args[0] & EXT_READ_COUNTERS_FLAG_RESET) != 0);
+
+    for (unsigned i = 0; i < EVENT_COUNTER_NUM_COUNTERS; i++)
+        AppendResponse(counts[i], sizeof(counts[i]));
+
+    return EXT_STATUS_OK;
+}
+
+/**
+ * Handler for the EXT_OPCODE_READ_LOOP_STATS command
+ *
+ * @param[in] args The command arguments following the opcode
+ * @param[in] len The number of argument bytes
+ *
+ * @return Returns the EXT_STATUS_* status of the command
+ */
+static uint8_t HandlerReadLoopStats(const uint8_t *args, size_t len)
+{
+    struct ProfilerLoopStats stats;
+
+    ProfilerReadLoopStats(&stats, (args[0] & EXT_READ_LOOP_STATS_FLAG_RESET) != 0);
+
+    AppendResponse(stats.Iterations, sizeof(stats.Iterations));
+    AppendResponse(stats.MaxIterationUs, sizeof(stats.MaxIterationUs));
+
+    for (unsigned i = 0; i < PROFILER_NUM_TASKS; i++)
+        AppendResponse(stats.MaxTaskUs[i], sizeof(stats.MaxTaskUs[i]));
+
+    return EXT_STATUS_OK;
+}
+
+/**
+ * Handler for the EXT_OPCODE_READ_COMMAND_STATS command
+ *
+ * @param[in] args The command arguments following the opcode
+ * @param[in] len The number of argument bytes
+ *
+ * @return Returns the EXT_STATUS_* status of the command
+ */
+static uint8_t HandlerReadCommandStats(const uint8_t *args, size_t len)
+{
+    uint8_t status = EXT_STATUS_INVALID_ARGUMENT;
+    struct LatencyStats stats;
+
+    if (AduProtocolReadStats(args[0], &stats, (args[1] & EXT_READ_COMMAND_STATS_FLAG_RESET) != 0))
+    {
+        AppendResponse(args[0], 1);
+        AppendLatencyStats(&stats);
+        status = EXT_STATUS_OK;
+    }
+
+    return status;
+}
+
+/**
+ * Handler for the EXT_OPCODE_READ_PROFILE_HISTOGRAM command
+ *
+ * @param[in] args The command arguments following the opcode
+ * @param[in] len The number of argument bytes
+ *
+ * @return Returns the EXT_STATUS_* status of the command
+ */
+static uint8_t HandlerReadProfileHistogram(const uint8_t *args, size_t len)
+{
+    uint8_t status = EXT_STATUS_INVALID_ARGUMENT;
+    struct LatencyStats stats;
+
+    if (ProfilerReadHistogram(args[0], &stats, (args[1] & EXT_READ_PROFILE_HISTOGRAM_FLAG_RESET) != 0))
+    {
+        AppendResponse(args[0], 1);
+        AppendLatencyStats(&stats);
+        status = EXT_STATUS_OK;
+    }
+
+    return status;
+}
+
+/**
+ * Decodes a little-endian uint32_t command argument
+ *
+ * @param[in] args The argument bytes
+ *
+ * @return The decoded value
+ */
+static uint32_t DecodeUint32(const uint8_t *args)
+{
+    return args[0] | (args[1] << 8) | (args[2] << 16) | ((uint32_t)args[3] << 24);
+}
+
+/**
+ * Handler for the EXT_OPCODE_PULSE_RELAYS command
+ *
+ * @param[in] args The command arguments following the opcode
+ * @param[in] len The number of argument bytes
+ *
+ * @return Returns the EXT_STATUS_* status of the command
+ */
+static uint8_t HandlerPulseRelays(const uint8_t *args, size_t len)
+{
+    uint8_t status = EXT_STATUS_INVALID_ARGUMENT;
+    uint32_t durationsUs[RELAY_PULSE_NUM_RELAYS] = { 0 };
+    size_t end = 1 + (size_t)args[0] * EXT_PULSE_RELAYS_PAIR_SIZE;
+    bool valid = args[0] > 0 && end <= len;
+
+    for (size_t pos = 1; valid && pos < end; pos += EXT_PULSE_RELAYS_PAIR_SIZE)
+    {
+        uint8_t mask = args[pos];
+        uint32_t durationUs = DecodeUint32(&args[pos + 1]);
+
+        if (durationUs == 0 || durationUs > RELAY_PULSE_MAX_DURATION_US)
+            valid = false;
+
+        for (unsigned i = 0; i < RELAY_PULSE_NUM_RELAYS; i++)
+        {
+            if ((mask & (1 << i)) != 0)
+                durationsUs[i] = durationUs;
+        }
+    }
+
+    if (valid && RelayPulseStart(durationsUs))
+        status = EXT_STATUS_OK;
+
+    return status;
+}
+
+/**
+ * Handler for the EXT_OPCODE_SEQUENCER_LOAD command
+ *
+ * @param[in] args The command arguments following the opcode
+ * @param[in] len The number of argument bytes
+ *
+ * @return Returns the EXT_STATUS_* status of the command
+ */
+static uint8_t HandlerSequencerLoad(const uint8_t *args, size_t len)
+{
+    uint8_t status = EXT_STATUS_OK;
+    unsigned index = args[0];
+    size_t numSteps = 1;
+
+#ifdef ENABLE_EXTENDED_REPORTS
+    numSteps = args[1];
+#endif
+
+    size_t end = EXT_SEQUENCER_LOAD_HEADER_SIZE + numSteps * EXT_SEQUENCER_LOAD_STEP_SIZE;
+
+    if (SequencerIsRunning())
+        status = EXT_STATUS_BUSY;
+    else if (numSteps == 0 || end > len)
+        status = EXT_STATUS_INVALID_ARGUMENT;
+
+    for (size_t pos = EXT_SEQUENCER_LOAD_HEADER_SIZE; status == EXT_STATUS_OK && pos < end;
+         pos += EXT_SEQUENCER_LOAD_STEP_SIZE)
+    {
+        if (!SequencerLoadStep(index++, DecodeUint32(&args[pos]), args[pos + 4]))
+            status = EXT_STATUS_INVALID_ARGUMENT;
+    }
+
+    return status;
+}
+
+/**
+ * Handler for the EXT_OPCODE_SEQUENCER_START command
+ *
+ * @param[in] args The command arguments following the opcode
+ * @param[in] len The number of argument bytes
+ *
+ * @return Returns the EXT_STATUS_* status of the command
+ */
+static uint8_t HandlerSequencerStart(const uint8_t *args, size_t len)
+{
+    uint8_t status = EXT_STATUS_INVALID_ARGUMENT;
+    bool loop = (args[1] & EXT_SEQUENCER_START_FLAG_LOOP) != 0;
+
+    if (SequencerStart(args[0], loop, DecodeUint32(&args[2])))
+        status = EXT_STATUS_OK;
+
+    return status;
+}
+
+/**
+ * Handler for the EXT_OPCODE_SEQUENCER_STOP command
+ *
+ * @param[in] args The command arguments following the opcode
+ * @param[in] len The number of argument bytes
+ *
+ * @return Returns the EXT_STATUS_* status of the command
+ */
+static uint8_t HandlerSequencerStop(const uint8_t *args, size_t len)
+{
+    SequencerStop();
+
+    return EXT_STATUS_OK;
+}
+
+/**
+ * Handler for the EXT_OPCODE_CONFIGURE_EDGE_LOG command
+ *
+ * @param[in] args The command arguments following the opcode
+ * @param[in] len The number of argument bytes
+ *
+ * @return Returns the EXT_STATUS_* status of the command
+ */
+static uint8_t HandlerConfigureEdgeLog(const uint8_t *args, size_t len)
+{
+    EdgeLogInputsSet(args[0]);
+
+    return EXT_STATUS_OK;
+}
+
+/**
+ * Handler for the EXT_OPCODE_READ_EDGE_LOG command
+ *
+ * @param[in] args The command arguments following the opcode
+ * @param[in] len The number of argument bytes
+ *
+ * @return Returns the EXT_STATUS_* status of the command
+ */
+static uint8_t HandlerReadEdgeLog(const uint8_t *args, size_t len)
+{
+    struct EdgeLogEntry entries[EXT_READ_EDGE_LOG_MAX_RECORDS];
+    size_t maxEntries = args[0] < EXT_READ_EDGE_LOG_MAX_RECORDS ? args[0] : EXT_READ_EDGE_LOG_MAX_RECORDS;
+    uint32_t dropped;
+    size_t count = EdgeLogRead(entries, maxEntries, &dropped);
+
+    AppendResponse(dropped, sizeof(dropped));
+    AppendResponse(count, 1);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        AppendResponse(entries[i].TimeUs, sizeof(entries[i].TimeUs));
+        AppendResponse(entries[i].Input | (entries[i].Rising ? EXT_EDGE_LOG_RISING : 0), 1);
+    }
+
+    return EXT_STATUS_OK;
+}
+
+#ifdef ENABLE_INPUT_CAPTURE
+/**
+ * Handler for the EXT_OPCODE_CONFIGURE_CAPTURE command
+ *
+ * @param[in] args The command arguments following the opcode
+ * @param[in] len The number of argument bytes
+ *
+ * @return Returns the EXT_STATUS_* status of the command
+ */
+static uint8_t HandlerConfigureCapture(const uint8_t *args, size_t len)
+{
+    CaptureTriggerSet(args[0], args[1], args[2] | (args[3] << 8), args[4] | (args[5] << 8));
+
+    return EXT_STATUS_OK;
+}
+
+/**
+ * Handler for the EXT_OPCODE_START_CAPTURE command
+ *
+ * @param[in] args The command arguments following the opcode
+ * @param[in] len The number of argument bytes
+ *
+ * @return Returns the EXT_STATUS_* status of the command
+ */
+static uint8_t HandlerStartCapture(const uint8_t *args, size_t len)
+{
+    uint8_t status = EXT_STATUS_INVALID_ARGUMENT;
+
+    if (CaptureStart(DecodeUint32(args)))
+        status = EXT_STATUS_OK;
+
+    return status;
+}
+
+/**
+ * Handler for the EXT_OPCODE_STOP_CAPTURE command
+ *
+ * @param[in] args The command arguments following the opcode
+ * @param[in] len The number of argument bytes
+ *
+ * @return Returns the EXT_STATUS_* status of the command
+ */
+static uint8_t HandlerStopCapture(const uint8_t *args, size_t len)
+{
+    CaptureStop();
+
+    return EXT_STATUS_OK;
+}
+
+/**
+ * Handler for the EXT_OPCODE_READ_CAPTURE_STATUS command
+ *
+ * @param[in] args The command arguments following the opcode
+ * @param[in] len The number of argument bytes
+ *
+ * @return Returns the EXT_STATUS_* status of the command
+ */
+static uint8_t HandlerReadCaptureStatus(const uint8_t *args, size_t len)
+{
+    struct CaptureStatus status;
+
+    CaptureStatusGet(&status);
+
+    AppendResponse(status.State, 1);
+    AppendResponse(status.Samples, sizeof(status.Samples));
+    AppendResponse(status.TriggerSample, sizeof(status.TriggerSample));
+    AppendResponse(status.LostSamples, sizeof(status.LostSamples));
+    AppendResponse(status.Runs, sizeof(status.Runs));
+
+    return EXT_STATUS_OK;
+}
+
+/**
+ * Handler for the EXT_OPCODE_READ_CAPTURE command
+ *
+ * @param[in] args The command arguments following the opcode
+ * @param[in] len The number of argument bytes
+ *
+ * @return Returns the EXT_STATUS_* status of the command
+ */
+static uint8_t HandlerReadCapture(const uint8_t *args, size_t len)
+{
+    uint8_t values[EXT_READ_CAPTURE_MAX_RUNS];
+    uint16_t lengths[EXT_READ_CAPTURE_MAX_RUNS];
+    unsigned first = args[0] | (args[1] << 8);
+    size_t maxRuns = args[2] < EXT_READ_CAPTURE_MAX_RUNS ? args[2] : EXT_READ_CAPTURE_MAX_RUNS;
+    size_t count = CaptureReadRuns(first, values, lengths, maxRuns);
+
+    AppendResponse(first, 2);
+    AppendResponse(count, 1);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        AppendResponse(values[i], sizeof(values[i]));
+        AppendResponse(lengths[i], sizeof(lengths[i]));
+    }
+
+    return EXT_STATUS_OK;
+}
+#endif
+
+/**
+ * Handler for the EXT_OPCODE_CONFIGURE_WATCHDOG command
+ *
+ * @param[in] args The command arguments following the opcode
+ * @param[in] len The number of argument bytes
+ *
+ * @return Returns the EXT_STATUS_* status of the command
+ */
+static uint8_t HandlerConfigureWatchdog(const uint8_t *args, size_t len)
+{
+    uint8_t status = EXT_STATUS_INVALID_ARGUMENT;
+
+    if (WatchdogTimeoutSet(DecodeUint32(args)))
+        status = EXT_STATUS_OK;
+
+    return status;
+}
+
+/**
+ * Handler for the EXT_OPCODE_READ_WATCHDOG_STATS command
+ *
+ * @param[in] args The command arguments following the opcode
+ * @param[in] len The number of argument bytes
+ *
+ * @return Returns the EXT_STATUS_* status of the command
+ */
+static uint8_t HandlerReadWatchdogStats(const uint8_t *args, size_t len)
+{
+    struct WatchdogStats stats;
+    uint32_t timeoutUs = WatchdogTimeoutGet();
+
+    WatchdogReadStats(&stats, (args[0] & EXT_READ_WATCHDOG_STATS_FLAG_RESET) != 0);
+
+    AppendResponse(timeoutUs, sizeof(timeoutUs));
+    AppendResponse(stats.Trips, sizeof(stats.Trips));
+    AppendResponse(stats.LastTripLatencyUs, sizeof(stats.LastTripLatencyUs));
+    AppendResponse(stats.MaxTripLatencyUs, sizeof(stats.MaxTripLatencyUs));
+
+    return EXT_STATUS_OK;
+}
+
+/**
+ * Handler for the EXT_OPCODE_CONFIGURE_DEBOUNCE command
+ *
+ * @param[in] args The command arguments following the opcode
+ * @param[in] len The number of argument bytes
+ *
+ * @return Returns the EXT_STATUS_* status of the command
+ */
+static uint8_t HandlerConfigureDebounce(const uint8_t *args, size_t len)
+{
+    uint8_t status = EXT_STATUS_INVALID_ARGUMENT;
+
+    if (EventCounterDebounceTimeSet(args[0], DecodeUint32(&args[1])))
+        status = EXT_STATUS_OK;
+
+    return status;
+}
+
+/**
+ * Handler for the EXT_OPCODE_READ_DEBOUNCE command
+ *
+ * @param[in] args The command arguments following the opcode
+ * @param[in] len The number of argument bytes
+ *
+ * @return Returns the EXT_STATUS_* status of the command
+ */
+static uint8_t HandlerReadDebounce(const uint8_t *args, size_t len)
+{
+    for (unsigned i = 0; i < EVENT_COUNTER_NUM_COUNTERS; i++)
+        AppendResponse(EventCounterDebounceTimeGet(i), 4);
+
+    return EXT_STATUS_OK;
+}
+
+/**
+ * Handler for the EXT_OPCODE_READ_SNAPSHOT command
+ *
+ * @param[in] args The command arguments following the opcode
+ * @param[in] len The number of argument bytes
+ *
+ * @return Returns the EXT_STATUS_* status of the command
+ */
+static uint8_t HandlerReadSnapshot(const uint8_t *args, size_t len)
+{
+    struct StreamingSnapshot snapshot;
+
+    StreamingSnapshotTake(&snapshot, (args[0] & EXT_READ_SNAPSHOT_FLAG_RESET) != 0);
+
+    AppendResponse(snapshot.TimeUs, sizeof(snapshot.TimeUs));
+    AppendResponse(snapshot.Relays, sizeof(snapshot.Relays));
+    AppendResponse(snapshot.Inputs, sizeof(snapshot.Inputs));
+    AppendResponse(snapshot.DebouncedInputs, sizeof(snapshot.DebouncedInputs));
+    AppendResponse(snapshot.TrackedInputs, sizeof(snapshot.TrackedInputs));
+
+    for (unsigned i = 0; i < EVENT_COUNTER_NUM_COUNTERS; i++)
+        AppendResponse(snapshot.Counts[i], sizeof(snapshot.Counts[i]));
+
+    return EXT_STATUS_OK;
+}
+
+/**
+ * Handler for the EXT_OPCODE_READ_SCHEDULER_STATS command
+ *
+ * @param[in] args The command arguments following the opcode
+ * @param[in] len The number of argument bytes
+ *
+ * @return Returns the EXT_STATUS_* status of the command
+ */
+static uint8_t HandlerReadSchedulerStats(const uint8_t *args, size_t len)
+{
+    uint8_t status = EXT_STATUS_INVALID_ARGUMENT;
+    struct SchedulerTaskStats stats;
+
+    if (SchedulerReadTaskStats(args[0], &stats, (args[1] & EXT_READ_SCHEDULER_STATS_FLAG_RESET) != 0))
+    {
+        AppendResponse(args[0], 1);
+        AppendResponse(stats.DeadlineUs, sizeof(stats.DeadlineUs));
+        AppendResponse(stats.Runs, sizeof(stats.Runs));
+        AppendResponse(stats.Overruns, sizeof(stats.Overruns));
+        AppendResponse(stats.MaxIntervalUs, sizeof(stats.MaxIntervalUs));
+        status = EXT_STATUS_OK;
+    }
+
+    return status;
+}
+
+/**
+ * Handler for the EXT_OPCODE_READ_DROPPED_REPORTS command
+ *
+ * @param[in] args The command arguments following the opcode
+ * @param[in] len The number of argument bytes
+ *
+ * @return Returns the EXT_STATUS_* status of the command
+ */
+static uint8_t HandlerReadDroppedReports(const uint8_t *args, size_t len)
+{
+    uint32_t dropped = UsbReadDroppedReports((args[0] & EXT_READ_DROPPED_REPORTS_FLAG_RESET) != 0);
+
+    AppendResponse(dropped, sizeof(dropped));
+
+    return EXT_STATUS_OK;
+}
+
+/**
+ * Command processor table entry. Associates a command handler function with
+ * an opcode
+ */
+struct ExtCommandEntry
+{
+    /** The minimum number of argument bytes the handler requires */
+    size_t MinArgsLen;
+
+    /**
+     * The function to handle commands with this opcode. The handler appends
+     * any response data to the response buffer.
+     *
+     * @param[in] args The command arguments following the opcode
+     * @param[in] len The number of argument bytes (at least MinArgsLen)
+     *
+     * @return Returns the EXT_STATUS_* status of the command
+     */
+    uint8_t (*Handler)(const uint8_t *args, size_t len);
+};
+
+/** Table of handlers for processing each command, indexed by opcode */
+static const struct ExtCommandEntry ENTRIES[] =
+{
+    [EXT_OPCODE_READ_COUNTERS]          = { 1, HandlerReadCounters },
+    [EXT_OPCODE_READ_LOOP_STATS]        = { 1, HandlerReadLoopStats },
+    [EXT_OPCODE_READ_COMMAND_STATS]     = { 2, HandlerReadCommandStats },
+    [EXT_OPCODE_READ_PROFILE_HISTOGRAM] = { 2, HandlerReadProfileHistogram },
+    [EXT_OPCODE_PULSE_RELAYS]           = { 1 + EXT_PULSE_RELAYS_PAIR_SIZE, HandlerPulseRelays },
+    [EXT_OPCODE_SEQUENCER_LOAD]         = { EXT_SEQUENCER_LOAD_HEADER_SIZE + EXT_SEQUENCER_LOAD_STEP_SIZE, HandlerSequencerLoad },
+    [EXT_OPCODE_SEQUENCER_START]        = { 6, HandlerSequencerStart },
+    [EXT_OPCODE_SEQUENCER_STOP]         = { 0, HandlerSequencerStop },
+    [EXT_OPCODE_CONFIGURE_EDGE_LOG]     = { 1, HandlerConfigureEdgeLog },
+    [EXT_OPCODE_READ_EDGE_LOG]          = { 1, HandlerReadEdgeLog },
+#ifdef ENABLE_INPUT_CAPTURE
+    [EXT_OPCODE_CONFIGURE_CAPTURE]      = { 6, HandlerConfigureCapture },
+    [EXT_OPCODE_START_CAPTURE]          = { 4, HandlerStartCapture },
+    [EXT_OPCODE_STOP_CAPTURE]           = { 0, HandlerStopCapture },
+    [EXT_OPCODE_READ_CAPTURE_STATUS]    = { 0, HandlerReadCaptureStatus },
+    [EXT_OPCODE_READ_CAPTURE]           = { 3, HandlerReadCapture },
+#endif
+    [EXT_OPCODE_CONFIGURE_WATCHDOG]     = { 4, HandlerConfigureWatchdog },
+    [EXT_OPCODE_READ_WATCHDOG_STATS]    = { 1, HandlerReadWatchdogStats },
+    [EXT_OPCODE_CONFIGURE_DEBOUNCE]     = { 5, HandlerConfigureDebounce },
+    [EXT_OPCODE_READ_DEBOUNCE]          = { 0, HandlerReadDebounce },
+    [EXT_OPCODE_READ_SNAPSHOT]          = { 1, HandlerReadSnapshot },
+    [EXT_OPCODE_READ_SCHEDULER_STATS]   = { 2, HandlerReadSchedulerStats },
+    [EXT_OPCODE_READ_DROPPED_REPORTS]   = { 1, HandlerReadDroppedReports },
+};
+
+/** The number of entries in the command processor table */
+static const size_t NUM_ENTRIES = sizeof(ENTRIES) / sizeof(ENTRIES[0]);
+
+bool ExtProtocolProcessCommand(const uint8_t *buf, size_t len)
+{
+    uint8_t status = EXT_STATUS_UNKNOWN_OPCODE;
+
+    if (len >= 1)
+    {
+        uint8_t opcode = buf[0];
+
+        // Every response starts with the opcode and status (filled in below)
+        ResponseBufLen = 0;
+        AppendResponse(opcode, 1);
+        AppendResponse(status, 1);
+
+        if (opcode < NUM_ENTRIES && ENTRIES[opcode].Handler != NULL)
+        {
+            const struct ExtCommandEntry *entry = &ENTRIES[opcode];
+
+            if (len - 1 < entry->MinArgsLen)
+                status = EXT_STATUS_INVALID_ARGUMENT;
+            else
+                status = entry->Handler(&buf[1], len - 1);
+        }
+
+        ResponseBuf[1] = status;
+
+        if (status != EXT_STATUS_OK)
+        {
+            // Failed commands only report the status
+            BoardDebugPrint("%s: Opcode 0x%02x failed with status %u\r\n", __func__, opcode, status);
+            ResponseBufLen = 2;
+        }
+    }
+
+    // Handling any command should reset the watchdog timer
+    WatchdogKick();
+
+    return status == EXT_STATUS_OK;
+}
+
+size_t ExtProtocolGetResponse(uint8_t *buf, size_t len)
+{
+    size_t ret = 0;
+
+    if (ResponseBufLen > 0 && ResponseBufLen <= len)
+    {
+        memcpy(buf, ResponseBuf, ResponseBufLen);
+        ret = ResponseBufLen;
+        ResponseBufLen = 0;
+    }
+
+    return ret;
+}
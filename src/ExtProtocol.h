@@ -0,0 +1,288 @@
+/*
+Copyright 2021 Frank Jenner
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef EXT_PROTOCOL_H
+#define EXT_PROTOCOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * The extended protocol is a binary command/response protocol for the
+ * functionality that doesn't fit in the ASCII ADU protocol. Each command
+ * consists of an opcode byte followed by any argument bytes for that opcode.
+ * Every command elicits a response consisting of the opcode, a status byte
+ * (one of the EXT_STATUS_* values), and then any response data. All multi-byte
+ * values are little-endian.
+ */
+
+/**
+ * Read all event counters as 32-bit counts captured at the same instant.
+ * Argument: flags byte (EXT_READ_COUNTERS_FLAG_*). Response data: the eight
+ * uint32_t counts, counter 0 first.
+ */
+#define EXT_OPCODE_READ_COUNTERS        0x01
+#define EXT_READ_COUNTERS_FLAG_RESET    0x01
+
+/**
+ * Read the main loop timing statistics. Argument: flags byte
+ * (EXT_READ_LOOP_STATS_FLAG_*). Response data: the uint32_t number of loop
+ * iterations measured, the uint32_t longest iteration in microseconds, and
+ * then the uint32_t longest run of each task (see enum ProfilerTask) in
+ * microseconds.
+ */
+#define EXT_OPCODE_READ_LOOP_STATS      0x02
+#define EXT_READ_LOOP_STATS_FLAG_RESET  0x01
+
+/**
+ * Read the execution statistics for one kind of ADU command (see
+ * AduProtocolReadStats() for the slot numbers). Arguments: slot byte, then
+ * flags byte (EXT_READ_COMMAND_STATS_FLAG_*). Response data: the slot byte,
+ * then the uint32_t count, uint32_t error count, uint16_t minimum and maximum
+ * durations in microseconds, and the LATENCY_STATS_NUM_BUCKETS uint16_t
+ * histogram buckets.
+ */
+#define EXT_OPCODE_READ_COMMAND_STATS       0x03
+#define EXT_READ_COMMAND_STATS_FLAG_RESET   0x01
+
+/**
+ * Read one of the profiler's execution time histograms (see enum
+ * ProfilerHistogram). Arguments: histogram byte, then flags byte
+ * (EXT_READ_PROFILE_HISTOGRAM_FLAG_*). Response data: the histogram byte,
+ * then the statistics in the same layout as EXT_OPCODE_READ_COMMAND_STATS.
+ */
+#define EXT_OPCODE_READ_PROFILE_HISTOGRAM       0x04
+#define EXT_READ_PROFILE_HISTOGRAM_FLAG_RESET   0x01
+
+/**
+ * Close relays and open each of them again after its own duration, timed on
+ * the device (see RelayPulseStart()). Arguments: the number of pairs byte,
+ * then that many pairs of a relay mask byte and a uint32_t duration in
+ * microseconds, applied in order so that later pairs override earlier ones
+ * for the same relay. Any bytes after the last pair (e.g. report padding) are
+ * ignored. Every pulse starts at the same instant. No response data.
+ */
+#define EXT_OPCODE_PULSE_RELAYS         0x05
+#define EXT_PULSE_RELAYS_PAIR_SIZE      5
+
+/**
+ * Store steps of the relay sequence (see SequencerLoadStep()). Arguments: the
+ * index byte of the first step, the number of steps byte (with extended
+ * reports only), then that many steps, each consisting of a uint32_t offset
+ * in microseconds and a relay states byte. An 8-byte report only has room for
+ * one step, so without extended reports there is no number of steps byte and
+ * exactly one step is stored. Any bytes after the last step (e.g. report
+ * padding) are ignored. Fails with EXT_STATUS_BUSY while the sequence is
+ * playing. No response data.
+ */
+#define EXT_OPCODE_SEQUENCER_LOAD       0x06
+#define EXT_SEQUENCER_LOAD_STEP_SIZE    5
+#ifdef ENABLE_EXTENDED_REPORTS
+#define EXT_SEQUENCER_LOAD_HEADER_SIZE  2
+#else
+#define EXT_SEQUENCER_LOAD_HEADER_SIZE  1
+#endif
+
+/**
+ * Start playing the relay sequence (see SequencerStart()). Arguments: the
+ * number of steps byte, a flags byte (EXT_SEQUENCER_START_FLAG_*), then the
+ * uint32_t loop period in microseconds. No response data.
+ */
+#define EXT_OPCODE_SEQUENCER_START      0x07
+#define EXT_SEQUENCER_START_FLAG_LOOP   0x01
+
+/**
+ * Stop playing the relay sequence, leaving the relays in their current
+ * states. No arguments. No response data.
+ */
+#define EXT_OPCODE_SEQUENCER_STOP       0x08
+
+/**
+ * Select the inputs whose debounced edges are logged, discarding the current
+ * log (see EdgeLogInputsSet()). Argument: input mask byte. No response data.
+ */
+#define EXT_OPCODE_CONFIGURE_EDGE_LOG   0x09
+
+/**
+ * Remove the oldest records from the edge log. Argument: the maximum number
+ * of records byte (at most EXT_READ_EDGE_LOG_MAX_RECORDS are returned).
+ * Response data: the uint32_t number of edges dropped since the previous
+ * read, the number of records byte, and then each record as a uint32_t
+ * timestamp in microseconds followed by an input byte (the input index, with
+ * EXT_EDGE_LOG_RISING set for a rising edge).
+ */
+#define EXT_OPCODE_READ_EDGE_LOG        0x0a
+#define EXT_READ_EDGE_LOG_MAX_RECORDS   11
+#define EXT_EDGE_LOG_RECORD_SIZE        5
+#define EXT_EDGE_LOG_RISING             0x80
+
+/*
+ * The input capture commands are only available when built with
+ * ENABLE_INPUT_CAPTURE, and otherwise fail with EXT_STATUS_UNKNOWN_OPCODE.
+ */
+
+/**
+ * Configure the trigger for subsequent captures (see CaptureTriggerSet()).
+ * Arguments: input mask byte, pattern byte, then the uint16_t numbers of
+ * samples before and after the trigger. No response data.
+ */
+#define EXT_OPCODE_CONFIGURE_CAPTURE    0x0b
+
+/**
+ * Start a capture, discarding the previous one. Argument: the uint32_t
+ * sample rate in hertz. No response data.
+ */
+#define EXT_OPCODE_START_CAPTURE        0x0c
+
+/**
+ * Stop the capture in progress, keeping what has been captured. No arguments.
+ * No response data.
+ */
+#define EXT_OPCODE_STOP_CAPTURE         0x0d
+
+/**
+ * Read the progress of the capture. No arguments. Response data: the state
+ * byte (see enum CaptureState), the uint32_t numbers of samples captured,
+ * trigger sample index, and lost samples, and the uint16_t number of runs.
+ */
+#define EXT_OPCODE_READ_CAPTURE_STATUS  0x0e
+
+/**
+ * Read runs of identical samples from a finished or stopped capture.
+ * Arguments: the uint16_t index of the first run, then the maximum number of
+ * runs byte (at most EXT_READ_CAPTURE_MAX_RUNS are returned). Response data:
+ * the uint16_t index of the first run, the number of runs byte, and then each
+ * run as the input states byte followed by the uint16_t number of samples.
+ */
+#define EXT_OPCODE_READ_CAPTURE         0x0f
+#define EXT_READ_CAPTURE_MAX_RUNS       19
+
+/**
+ * Set the watchdog timeout and restart the timeout counter (see
+ * WatchdogTimeoutSet()). Argument: the uint32_t timeout in microseconds (at
+ * most WATCHDOG_MAX_TIMEOUT_US), or zero to disable the watchdog. No response
+ * data.
+ */
+#define EXT_OPCODE_CONFIGURE_WATCHDOG   0x10
+
+/**
+ * Read the watchdog timeout statistics (see struct WatchdogStats). Argument:
+ * flags byte. Response data: the uint32_t timeout in microseconds, then the
+ * uint32_t number of timeouts and the latest and longest delays between a
+ * timeout deadline and the relays opening, in microseconds.
+ */
+#define EXT_OPCODE_READ_WATCHDOG_STATS      0x11
+#define EXT_READ_WATCHDOG_STATS_FLAG_RESET  0x01
+
+/**
+ * Set the debounce time of some of the inputs (see
+ * EventCounterDebounceTimeSet()). Arguments: input mask byte, then the
+ * uint32_t debounce time in microseconds (at most
+ * EVENT_COUNTER_MAX_DEBOUNCE_TIME_US). No response data.
+ */
+#define EXT_OPCODE_CONFIGURE_DEBOUNCE   0x12
+
+/**
+ * Read the debounce time of every input. No arguments. Response data: the
+ * uint32_t debounce time of each input in microseconds, input 0 first.
+ */
+#define EXT_OPCODE_READ_DEBOUNCE        0x13
+
+/**
+ * Read the state of the board, all sampled at the same instant (see
+ * StreamingSnapshotTake()). Argument: flags byte. Response data: the uint32_t
+ * timestamp in microseconds, the relay port byte, the raw and debounced input
+ * bytes, the byte of inputs whose debounced state is valid, then the uint32_t
+ * event counts, counter 0 first.
+ */
+#define EXT_OPCODE_READ_SNAPSHOT        0x14
+#define EXT_READ_SNAPSHOT_FLAG_RESET    0x01
+
+/**
+ * Read the scheduling statistics of a main loop task (see
+ * SchedulerReadTaskStats()). Arguments: task byte (an enum ProfilerTask
+ * value), then flags byte (EXT_READ_SCHEDULER_STATS_FLAG_*). Response data:
+ * the task byte, then the uint32_t deadline in microseconds, number of runs,
+ * number of overruns and longest interval between runs in microseconds.
+ */
+#define EXT_OPCODE_READ_SCHEDULER_STATS     0x15
+#define EXT_READ_SCHEDULER_STATS_FLAG_RESET 0x01
+
+/**
+ * Read the number of output reports dropped because the queue of reports
+ * awaiting processing was full (see UsbReadDroppedReports()). Argument: flags
+ * byte (EXT_READ_DROPPED_REPORTS_FLAG_*). Response data: the uint32_t number
+ * of dropped reports.
+ */
+#define EXT_OPCODE_READ_DROPPED_REPORTS     0x16
+#define EXT_READ_DROPPED_REPORTS_FLAG_RESET 0x01
+
+/** The command succeeded */
+#define EXT_STATUS_OK                   0x00
+
+/** The opcode is not recognized */
+#define EXT_STATUS_UNKNOWN_OPCODE       0x01
+
+/** The command arguments are missing or invalid */
+#define EXT_STATUS_INVALID_ARGUMENT     0x02
+
+/** The command can't be carried out in the current state */
+#define EXT_STATUS_BUSY                 0x03
+
+/**
+ * The largest response produced by any command (EXT_OPCODE_READ_EDGE_LOG,
+ * sized to fit in a single fragment of a 64-byte report)
+ */
+#define EXT_PROTOCOL_MAX_RESPONSE_SIZE \
+    (2 + 4 + 1 + EXT_READ_EDGE_LOG_MAX_RECORDS * EXT_EDGE_LOG_RECORD_SIZE)
+
+/**
+ * Processes the extended protocol command in the provided buffer.
+ *
+ * @param[in] buf The buffer containing the command data
+ * @param[in] len The length of the command data
+ *
+ * @return Returns true on success or false on failure
+ */
+bool ExtProtocolProcessCommand(const uint8_t *buf, size_t len);
+
+/**
+ * Takes the response to the latest command, if it has not already been
+ * taken. As with the ADU protocol, a response that has not been taken is
+ * overwritten by the next command.
+ *
+ * @param[out] buf The buffer to populate with the response
+ * @param[in] len The length of the provided buffer
+ *
+ * @return Returns the length of the response, or zero if there is none
+ */
+size_t ExtProtocolGetResponse(uint8_t *buf, size_t len);
+
+#endif
@@ -0,0 +1,153 @@
+/*
+Copyright 2021 Frank Jenner
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "InputNotify.h"
+#include "EventCounter.h"
+#include "boards/Board.h"
+
+#include <stdbool.h>
+
+#define US_PER_MS 1000
+
+/** The inputs being watched, or zero if notifications are disabled */
+static uint8_t WatchedInputs;
+
+/** The minimum time between notifications */
+static uint32_t MinIntervalUs;
+
+/** The HID idle rate, or zero to only send notifications upon changes */
+static uint32_t IdleUs;
+
+/** The debounced state of the watched inputs as of the last check */
+static uint8_t LastState;
+
+/** The watched inputs that changed since the previous notification */
+static uint8_t ChangedInputs;
+
+/** The time at which the previous notification was sent */
+static uint32_t LastReportTimeUs;
+
+/** Whether a notification is waiting to be sent */
+static bool ReportDue;
+
+void InputNotifyInit()
+{
+    InputNotifyConfigure(0, 0);
+    IdleUs = 0;
+}
+
+void InputNotifyConfigure(uint8_t inputs, uint16_t minIntervalMs)
+{
+    EventCounterTrackInputs(EVENT_COUNTER_TRACKER_INPUT_NOTIFY, inputs);
+
+    WatchedInputs = inputs;
+    MinIntervalUs = (uint32_t)minIntervalMs * US_PER_MS;
+    LastState = EventCounterDebouncedInputsGet() & inputs;
+    ChangedInputs = 0;
+
+    // Report the initial state right away, so the host knows where it stands
+    LastReportTimeUs = BoardGetElapsedTimeUs() - MinIntervalUs;
+    ReportDue = inputs != 0;
+}
+
+void InputNotifyIdleSet(uint32_t idleMs)
+{
+    IdleUs = idleMs * US_PER_MS;
+}
+
+void InputNotifyTask()
+{
+    if (WatchedInputs != 0)
+    {
+        uint8_t state = EventCounterDebouncedInputsGet() & WatchedInputs;
+
+        ChangedInputs |= state ^ LastState;
+        LastState = state;
+
+        if (!ReportDue && InputNotifyTaskDelayUs() == 0)
+            ReportDue = true;
+    }
+}
+
+uint32_t InputNotifyTaskDelayUs()
+{
+    uint32_t delayUs = UINT32_MAX;
+
+    // Once a notification is due, it's up to the USB task to send it
+    if (WatchedInputs != 0 && !ReportDue)
+    {
+        uint32_t elapsedUs = BoardGetElapsedTimeUs() - LastReportTimeUs;
+        uint32_t waitUs = UINT32_MAX;
+
+        if (ChangedInputs != 0)
+            waitUs = MinIntervalUs;
+        else if (IdleUs != 0)
+            waitUs = IdleUs > MinIntervalUs ? IdleUs : MinIntervalUs;
+
+        if (waitUs != UINT32_MAX)
+            delayUs = elapsedUs >= waitUs ? 0 : waitUs - elapsedUs;
+    }
+
+    return delayUs;
+}
+
+size_t InputNotifyGetReport(uint8_t *buf, size_t len)
+{
+    size_t ret = 0;
+
+    if (ReportDue && len >= INPUT_NOTIFY_REPORT_SIZE)
+    {
+        // Report the latest state, even if it changed again since the
+        // notification became due
+        buf[0] = EventCounterDebouncedInputsGet() & WatchedInputs;
+        buf[1] = ChangedInputs | (buf[0] ^ LastState);
+        ret = INPUT_NOTIFY_REPORT_SIZE;
+
+        LastState = buf[0];
+        ChangedInputs = 0;
+        LastReportTimeUs = BoardGetElapsedTimeUs();
+        ReportDue = false;
+    }
+
+    return ret;
+}
+
+size_t InputNotifyReadState(uint8_t *buf, size_t len)
+{
+    size_t ret = 0;
+
+    if (len >= INPUT_NOTIFY_REPORT_SIZE)
+    {
+        buf[0] = EventCounterDebouncedInputsGet() & WatchedInputs;
+        buf[1] = 0;
+        ret = INPUT_NOTIFY_REPORT_SIZE;
+    }
+
+    return ret;
+}
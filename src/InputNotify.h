@@ -0,0 +1,104 @@
+/*
+Copyright 2021 Frank Jenner
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef INPUT_NOTIFY_H
+#define INPUT_NOTIFY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * The size of an input change notification: the debounced state of the
+ * selected inputs, and then the selected inputs that changed since the
+ * previous notification
+ */
+#define INPUT_NOTIFY_REPORT_SIZE 2
+
+/**
+ * Initialize input change notifications as disabled, with no idle reports
+ */
+void InputNotifyInit();
+
+/**
+ * Enables or disables notifications of changes to the debounced state of the
+ * inputs. Changes that occur less than @p minIntervalMs after the previous
+ * notification are combined into the next one.
+ *
+ * @param[in] inputs The inputs to watch, or zero to disable notifications
+ * @param[in] minIntervalMs The minimum time between notifications, in
+ *                          milliseconds
+ */
+void InputNotifyConfigure(uint8_t inputs, uint16_t minIntervalMs);
+
+/**
+ * Sets the HID idle rate, which is the longest time to go without sending a
+ * notification while notifications are enabled, even if nothing changed
+ *
+ * @param[in] idleMs The idle rate in milliseconds, or zero to only send
+ *                   notifications upon changes
+ */
+void InputNotifyIdleSet(uint32_t idleMs);
+
+/**
+ * Should be called periodically to check for changes to the inputs
+ */
+void InputNotifyTask();
+
+/**
+ * Gets how long InputNotifyTask() can go without being called before it has
+ * a notification to produce, given that the inputs can only change in an
+ * interrupt or in an earlier task
+ *
+ * @return Returns the delay in microseconds, or UINT32_MAX if no notification
+ *         is scheduled
+ */
+uint32_t InputNotifyTaskDelayUs();
+
+/**
+ * Takes the pending notification, if there is one
+ *
+ * @param[out] buf The buffer to populate with the notification
+ * @param[in] len The length of the provided buffer
+ *
+ * @return Returns the length of the notification, or zero if none is pending
+ */
+size_t InputNotifyGetReport(uint8_t *buf, size_t len);
+
+/**
+ * Gets the current state of the watched inputs in the notification format,
+ * without any changes, for answering a GET_REPORT request
+ *
+ * @param[out] buf The buffer to populate with the report
+ * @param[in] len The length of the provided buffer
+ *
+ * @return Returns the length of the report, or zero if the buffer is too small
+ */
+size_t InputNotifyReadState(uint8_t *buf, size_t len);
+
+#endif
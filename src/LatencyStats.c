@@ -0,0 +1,70 @@
+/*
+Copyright 2021 Frank Jenner
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "LatencyStats.h"
+
+#define STATS_MAX_VALUE 0xffff
+
+void LatencyStatsReset(struct LatencyStats *stats)
+{
+    stats->Count = 0;
+    stats->Errors = 0;
+    stats->MinUs = 0;
+    stats->MaxUs = 0;
+
+    for (unsigned i = 0; i < LATENCY_STATS_NUM_BUCKETS; i++)
+        stats->Buckets[i] = 0;
+}
+
+void LatencyStatsRecord(struct LatencyStats *stats, uint32_t durationUs, bool success)
+{
+    uint16_t clampedUs = durationUs < STATS_MAX_VALUE ? durationUs : STATS_MAX_VALUE;
+    unsigned bucket = 0;
+
+    stats->Count++;
+
+    if (!success)
+        stats->Errors++;
+
+    if (stats->Count == 1 || clampedUs < stats->MinUs)
+        stats->MinUs = clampedUs;
+
+    if (clampedUs > stats->MaxUs)
+        stats->MaxUs = clampedUs;
+
+    // The bucket index is the number of significant bits in the duration
+    while (durationUs > 0 && bucket < LATENCY_STATS_NUM_BUCKETS - 1)
+    {
+        durationUs >>= 1;
+        bucket++;
+    }
+
+    if (stats->Buckets[bucket] < STATS_MAX_VALUE)
+        stats->Buckets[bucket]++;
+}
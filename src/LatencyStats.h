@@ -0,0 +1,82 @@
+/*
+Copyright 2021 Frank Jenner
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * The number of histogram buckets. Bucket 0 counts durations of 0us, bucket
+ * n counts durations from 2^(n-1)us up to (2^n)-1us, and the last bucket also
+ * counts every longer duration, so the buckets resolve durations up to about
+ * 8ms (e.g. USB frames, or a main loop stalled by a burst of commands).
+ */
+#define LATENCY_STATS_NUM_BUCKETS 14
+
+/**
+ * Execution time statistics for a repeated operation. Zero-initialized
+ * statistics are equivalent to cleared statistics.
+ */
+struct LatencyStats
+{
+    /** The number of times the operation was performed */
+    uint32_t Count;
+
+    /** The number of times the operation failed */
+    uint32_t Errors;
+
+    /** The shortest duration, in microseconds (zero if Count is zero) */
+    uint16_t MinUs;
+
+    /** The longest duration, in microseconds (saturating at 0xffff) */
+    uint16_t MaxUs;
+
+    /** Histogram of durations on a log2 scale (each saturating at 0xffff) */
+    uint16_t Buckets[LATENCY_STATS_NUM_BUCKETS];
+};
+
+/**
+ * Clears the statistics
+ *
+ * @param[out] stats The statistics to clear
+ */
+void LatencyStatsReset(struct LatencyStats *stats);
+
+/**
+ * Records one performance of the operation in the statistics
+ *
+ * @param[in,out] stats The statistics to update
+ * @param[in] durationUs How long the operation took, in microseconds
+ * @param[in] success Whether the operation succeeded
+ */
+void LatencyStatsRecord(struct LatencyStats *stats, uint32_t durationUs, bool success);
+
+#endif
@@ -30,23 +30,87 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "boards/Board.h"
 #include "Usb.h"
 #include "EventCounter.h"
+#include "EdgeLog.h"
+#include "InputNotify.h"
 #include "Watchdog.h"
+#include "Streaming.h"
+#include "Profiler.h"
+#include "RelayPulse.h"
+#include "Sequencer.h"
+#include "Capture.h"
+#include "Scheduler.h"
+
+/**
+ * The longest the inputs should go without being sampled (or without expired
+ * debounce periods being retired) while the main loop is busy
+ */
+#define INPUT_TASKS_DEADLINE_US 100
+
+/** The longest USB events should wait to be serviced: one USB frame */
+#define USB_TASK_DEADLINE_US    1000
+
+/**
+ * Runs the event counter task, followed by the input notification task so
+ * that it sees every debounced change as soon as the event counter makes it
+ */
+static void InputTasks()
+{
+    EventCounterTask();
+    InputNotifyTask();
+}
+
+/**
+ * Gets how long InputTasks() can go without being called before either task
+ * has work to do
+ *
+ * @return Returns the delay in microseconds, or UINT32_MAX if there is no
+ *         scheduled work
+ */
+static uint32_t InputTasksDelayUs()
+{
+    uint32_t delayUs = EventCounterTaskDelayUs();
+    uint32_t notifyDelayUs = InputNotifyTaskDelayUs();
+
+    return notifyDelayUs < delayUs ? notifyDelayUs : delayUs;
+}
+
+/** The main loop tasks, in priority order */
+static const struct SchedulerTask TASKS[] =
+{
+    { InputTasks, InputTasksDelayUs, INPUT_TASKS_DEADLINE_US, PROFILER_TASK_EVENT_COUNTER },
+    { WatchdogTask, WatchdogTaskDelayUs, 0, PROFILER_TASK_WATCHDOG },
+    { StreamingTask, StreamingTaskDelayUs, 0, PROFILER_TASK_STREAMING },
+#ifdef ENABLE_INPUT_CAPTURE
+    // The samples are read out from the DMA interrupt, so the task only has to
+    // keep up with its periodic flush
+    { CaptureTask, CaptureTaskDelayUs, CAPTURE_FLUSH_INTERVAL_US, PROFILER_TASK_CAPTURE },
+#endif
+    // Run the USB task last, so that anything the other tasks produced (e.g.
+    // a streaming frame) is sent before the loop goes to sleep
+    { UsbTask, UsbTaskDelayUs, USB_TASK_DEADLINE_US, PROFILER_TASK_USB },
+};
 
 int main(int argc, char *argv[])
 {
     BoardInit();
 
     EventCounterInit();
+    EdgeLogInit();
+    InputNotifyInit();
     WatchdogInit();
+    StreamingInit();
     UsbInit();
+    ProfilerInit();
+    RelayPulseInit();
+    SequencerInit();
+#ifdef ENABLE_INPUT_CAPTURE
+    CaptureInit();
+#endif
+    SchedulerInit(TASKS, sizeof(TASKS) / sizeof(TASKS[0]));
 
     // Loop forever
     for (;;)
-    {
-        UsbTask();
-        EventCounterTask();
-        WatchdogTask();
-    }
+        SchedulerRun();
 
     // Should never get here
     return -1;
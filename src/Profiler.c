@@ -0,0 +1,130 @@
+/*
+Copyright 2021 Frank Jenner
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "Profiler.h"
+#include "boards/Board.h"
+
+#include <string.h>
+
+/** The time at which the current main loop iteration started */
+static uint32_t LoopStartTimeUs;
+
+/** The time at which the previous task (or the current iteration) started */
+static uint32_t TaskStartTimeUs;
+
+/** The main loop statistics accumulated since the last reset */
+static struct ProfilerLoopStats LoopStats;
+
+/**
+ * The histograms accumulated since their last reset. The interrupt histograms
+ * are updated from interrupt context.
+ */
+static struct LatencyStats Histograms[PROFILER_NUM_HISTOGRAMS];
+
+/**
+ * Records an interrupt timing measurement from the board
+ *
+ * @param[in] event The kind of measurement
+ * @param[in] valueUs The measured time, in microseconds
+ */
+static void HandleProfileEvent(enum BoardProfileEvent event, uint32_t valueUs)
+{
+    if (event == BOARD_PROFILE_USB_ISR_DURATION)
+        LatencyStatsRecord(&Histograms[PROFILER_HISTOGRAM_USB_ISR_DURATION], valueUs, true);
+    else if (event == BOARD_PROFILE_ISR_ENTRY_LATENCY)
+        LatencyStatsRecord(&Histograms[PROFILER_HISTOGRAM_ISR_ENTRY_LATENCY], valueUs, true);
+}
+
+void ProfilerInit()
+{
+    memset(&LoopStats, 0, sizeof(LoopStats));
+
+    for (unsigned i = 0; i < PROFILER_NUM_HISTOGRAMS; i++)
+        LatencyStatsReset(&Histograms[i]);
+
+    BoardProfileCallbackSet(HandleProfileEvent);
+}
+
+void ProfilerLoopStart()
+{
+    LoopStartTimeUs = BoardGetElapsedTimeUs();
+    TaskStartTimeUs = LoopStartTimeUs;
+}
+
+void ProfilerLoopEnd()
+{
+    uint32_t iterationUs = BoardGetElapsedTimeUs() - LoopStartTimeUs;
+
+    if (iterationUs > LoopStats.MaxIterationUs)
+        LoopStats.MaxIterationUs = iterationUs;
+
+    LatencyStatsRecord(&Histograms[PROFILER_HISTOGRAM_LOOP_ITERATION], iterationUs, true);
+    LoopStats.Iterations++;
+}
+
+void ProfilerTaskDone(enum ProfilerTask task)
+{
+    uint32_t currentTimeUs = BoardGetElapsedTimeUs();
+    uint32_t taskUs = currentTimeUs - TaskStartTimeUs;
+
+    if (taskUs > LoopStats.MaxTaskUs[task])
+        LoopStats.MaxTaskUs[task] = taskUs;
+
+    TaskStartTimeUs = currentTimeUs;
+}
+
+void ProfilerReadLoopStats(struct ProfilerLoopStats *stats, bool resetAfterRead)
+{
+    *stats = LoopStats;
+
+    if (resetAfterRead)
+        memset(&LoopStats, 0, sizeof(LoopStats));
+}
+
+bool ProfilerReadHistogram(unsigned histogram, struct LatencyStats *stats, bool resetAfterRead)
+{
+    bool success = false;
+
+    if (histogram < PROFILER_NUM_HISTOGRAMS)
+    {
+        // The interrupt histograms may be updated from interrupt context
+        uint32_t state = BoardEnterCritical();
+
+        *stats = Histograms[histogram];
+
+        if (resetAfterRead)
+            LatencyStatsReset(&Histograms[histogram]);
+
+        BoardExitCritical(state);
+
+        success = true;
+    }
+
+    return success;
+}
@@ -0,0 +1,128 @@
+/*
+Copyright 2021 Frank Jenner
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "LatencyStats.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** The tasks run by each iteration of the main loop */
+enum ProfilerTask
+{
+    PROFILER_TASK_USB,
+    PROFILER_TASK_EVENT_COUNTER,
+    PROFILER_TASK_WATCHDOG,
+    PROFILER_TASK_STREAMING,
+    PROFILER_TASK_CAPTURE,
+
+    PROFILER_NUM_TASKS
+};
+
+/** The execution time histograms kept by the profiler */
+enum ProfilerHistogram
+{
+    /** Main loop iteration durations */
+    PROFILER_HISTOGRAM_LOOP_ITERATION,
+
+    /** Time spent servicing each USB interrupt */
+    PROFILER_HISTOGRAM_USB_ISR_DURATION,
+
+    /** Interrupt entry latency, as sampled by the board's periodic tick */
+    PROFILER_HISTOGRAM_ISR_ENTRY_LATENCY,
+
+    PROFILER_NUM_HISTOGRAMS
+};
+
+/** Main loop timing statistics */
+struct ProfilerLoopStats
+{
+    /** The number of main loop iterations measured */
+    uint32_t Iterations;
+
+    /**
+     * The longest main loop iteration, in microseconds, excluding any time
+     * spent asleep. This is the worst case stall between the arrival of new
+     * work and each task getting to run.
+     */
+    uint32_t MaxIterationUs;
+
+    /** The longest run of each task, in microseconds */
+    uint32_t MaxTaskUs[PROFILER_NUM_TASKS];
+};
+
+/**
+ * Initialize the profiler, clearing all statistics and starting the interrupt
+ * timing measurements
+ */
+void ProfilerInit();
+
+/**
+ * Must be called at the start of every main loop iteration
+ */
+void ProfilerLoopStart();
+
+/**
+ * Must be called at the end of every main loop iteration, before any sleep
+ * until the next one, so that the time spent asleep is not counted as part
+ * of the iteration
+ */
+void ProfilerLoopEnd();
+
+/**
+ * Must be called after each task in the main loop completes, in order to
+ * attribute the time since the previous task (or the start of the iteration)
+ * to this task
+ *
+ * @param[in] task The task that just completed
+ */
+void ProfilerTaskDone(enum ProfilerTask task);
+
+/**
+ * Reads the main loop timing statistics
+ *
+ * @param[out] stats The structure to populate with the statistics
+ * @param[in] resetAfterRead Whether to reset the statistics after reading
+ */
+void ProfilerReadLoopStats(struct ProfilerLoopStats *stats, bool resetAfterRead);
+
+/**
+ * Reads one of the execution time histograms
+ *
+ * @param[in] histogram The histogram to read
+ * @param[out] stats The structure to populate with the histogram
+ * @param[in] resetAfterRead Whether to reset the histogram after reading
+ *
+ * @return Returns true on success or false if the histogram is invalid
+ */
+bool ProfilerReadHistogram(unsigned histogram, struct LatencyStats *stats, bool resetAfterRead);
+
+#endif
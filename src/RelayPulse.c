@@ -0,0 +1,153 @@
+/*
+Copyright 2021 Frank Jenner
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "RelayPulse.h"
+#include "boards/Board.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/** The bit mask of relays whose pulses have not yet ended */
+static volatile uint8_t ActiveRelays;
+
+/** The time at which each active relay's pulse ends */
+static uint32_t EndTimesUs[RELAY_PULSE_NUM_RELAYS];
+
+/**
+ * Sets the alarm for the earliest end of any active pulse. Must be called
+ * with interrupts disabled.
+ *
+ * @param[in] nowUs The current time, in microseconds
+ */
+static void ScheduleAlarm(uint32_t nowUs);
+
+/**
+ * Alarm callback which opens the relays whose pulses have ended
+ *
+ * @param[in] timeUs The time for which the alarm was set
+ */
+static void PulseAlarm(uint32_t timeUs)
+{
+    uint32_t nowUs = BoardGetElapsedTimeUs();
+    uint8_t expired = 0;
+
+    (void)timeUs;
+
+    for (unsigned i = 0; i < RELAY_PULSE_NUM_RELAYS; i++)
+    {
+        if ((ActiveRelays & (1 << i)) != 0 && (int32_t)(EndTimesUs[i] - nowUs) <= 0)
+            expired |= 1 << i;
+    }
+
+    if (expired != 0)
+    {
+        BoardClearRelays(expired);
+        ActiveRelays &= ~expired;
+    }
+
+    ScheduleAlarm(nowUs);
+}
+
+static void ScheduleAlarm(uint32_t nowUs)
+{
+    if (ActiveRelays != 0)
+    {
+        uint32_t earliestUs = RELAY_PULSE_MAX_DURATION_US;
+
+        for (unsigned i = 0; i < RELAY_PULSE_NUM_RELAYS; i++)
+        {
+            if ((ActiveRelays & (1 << i)) != 0)
+            {
+                int32_t remainingUs = (int32_t)(EndTimesUs[i] - nowUs);
+
+                if (remainingUs < 0)
+                    remainingUs = 0;
+                if ((uint32_t)remainingUs < earliestUs)
+                    earliestUs = remainingUs;
+            }
+        }
+
+        BoardAlarmSet(BOARD_ALARM_RELAY_PULSE, nowUs + earliestUs, PulseAlarm);
+    }
+    else
+    {
+        BoardAlarmCancel(BOARD_ALARM_RELAY_PULSE);
+    }
+}
+
+void RelayPulseInit()
+{
+    uint32_t state = BoardEnterCritical();
+
+    ActiveRelays = 0;
+    BoardAlarmCancel(BOARD_ALARM_RELAY_PULSE);
+
+    BoardExitCritical(state);
+}
+
+bool RelayPulseStart(const uint32_t durationsUs[RELAY_PULSE_NUM_RELAYS])
+{
+    bool success = true;
+    uint8_t relays = 0;
+
+    for (unsigned i = 0; i < RELAY_PULSE_NUM_RELAYS; i++)
+    {
+        if (durationsUs[i] > RELAY_PULSE_MAX_DURATION_US)
+            success = false;
+        else if (durationsUs[i] != 0)
+            relays |= 1 << i;
+    }
+
+    if (success && relays != 0)
+    {
+        uint32_t state = BoardEnterCritical();
+
+        // Close all of the relays with a single write, and time every pulse
+        // from that same instant
+        BoardSetRelays(relays);
+        uint32_t nowUs = BoardGetElapsedTimeUs();
+
+        for (unsigned i = 0; i < RELAY_PULSE_NUM_RELAYS; i++)
+        {
+            if ((relays & (1 << i)) != 0)
+                EndTimesUs[i] = nowUs + durationsUs[i];
+        }
+
+        ActiveRelays |= relays;
+        ScheduleAlarm(nowUs);
+
+        BoardExitCritical(state);
+    }
+
+    return success;
+}
+
+uint8_t RelayPulseActiveGet()
+{
+    return ActiveRelays;
+}
@@ -0,0 +1,69 @@
+/*
+Copyright 2021 Frank Jenner
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef RELAY_PULSE_H
+#define RELAY_PULSE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** The number of relays that can be pulsed */
+#define RELAY_PULSE_NUM_RELAYS 8
+
+/** The longest supported pulse duration, in microseconds */
+#define RELAY_PULSE_MAX_DURATION_US 0x7fffffff
+
+/**
+ * Initialize the relay pulse module with no pulses in progress
+ */
+void RelayPulseInit();
+
+/**
+ * Closes the specified relays together and schedules each one to open again
+ * automatically after its own duration. The relays are opened from interrupt
+ * context, independently of the main loop and of the USB host.
+ *
+ * A relay that is already pulsing has its pulse restarted with the new
+ * duration. Relays with a duration of zero are left alone.
+ *
+ * @param[in] durationsUs The pulse duration for each relay, in microseconds,
+ *                        or zero to leave the relay alone
+ *
+ * @return Returns true on success, or false if a duration is too long
+ */
+bool RelayPulseStart(const uint32_t durationsUs[RELAY_PULSE_NUM_RELAYS]);
+
+/**
+ * Gets the relays that are currently pulsing
+ *
+ * @return The bit mask of pulsing relays
+ */
+uint8_t RelayPulseActiveGet();
+
+#endif
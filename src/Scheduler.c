@@ -0,0 +1,188 @@
+/*
+Copyright 2021 Frank Jenner
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "Scheduler.h"
+#include "boards/Board.h"
+
+#include <string.h>
+
+/** The tasks, in priority order */
+static const struct SchedulerTask *Tasks;
+static size_t NumTasks;
+
+/** The start time of each task's latest run, indexed by profiler task */
+static uint32_t LastStartTimesUs[PROFILER_NUM_TASKS];
+
+/** The statistics of each task, indexed by profiler task */
+static struct SchedulerTaskStats Stats[PROFILER_NUM_TASKS];
+
+/**
+ * Runs a task and updates its statistics
+ *
+ * @param[in] task The task to run
+ */
+static void RunTask(const struct SchedulerTask *task)
+{
+    struct SchedulerTaskStats *stats = &Stats[task->ProfilerTask];
+    uint32_t currentTimeUs = BoardGetElapsedTimeUs();
+    uint32_t intervalUs = currentTimeUs - LastStartTimesUs[task->ProfilerTask];
+
+    if (intervalUs > stats->MaxIntervalUs)
+        stats->MaxIntervalUs = intervalUs;
+
+    if (task->DeadlineUs != 0 && intervalUs > task->DeadlineUs)
+        stats->Overruns++;
+
+    stats->Runs++;
+    LastStartTimesUs[task->ProfilerTask] = currentTimeUs;
+
+    task->Run();
+    ProfilerTaskDone(task->ProfilerTask);
+}
+
+/**
+ * Runs every task whose deadline has arrived, in priority order
+ *
+ * @param[in] next The index of the task about to be run anyway, which is
+ *                 skipped
+ */
+static void RunOverdueTasks(size_t next)
+{
+    for (size_t i = 0; i < NumTasks; i++)
+    {
+        const struct SchedulerTask *task = &Tasks[i];
+
+        if (i != next && task->DeadlineUs != 0 &&
+            BoardGetElapsedTimeUs() - LastStartTimesUs[task->ProfilerTask] >= task->DeadlineUs)
+        {
+            RunTask(task);
+        }
+    }
+}
+
+#ifdef ENABLE_SLEEP_WHEN_IDLE
+/**
+ * Sleeps until an interrupt occurs or a task's next work is due, unless
+ * there is already work waiting for the main loop
+ */
+static void SleepUntilWork()
+{
+    // With interrupts disabled, an interrupt that arrives after the checks
+    // below still ends the sleep immediately, so no wakeup can be lost
+    uint32_t state = BoardEnterCritical();
+
+    if (!BoardWorkPendingGet())
+    {
+        uint32_t sleepUs = UINT32_MAX;
+
+        for (size_t i = 0; i < NumTasks; i++)
+        {
+            uint32_t delayUs = Tasks[i].DelayUs();
+
+            if (delayUs < sleepUs)
+                sleepUs = delayUs;
+        }
+
+        if (sleepUs > 0)
+        {
+            BoardSleep(sleepUs);
+
+            // No task had any work while asleep, so the time spent asleep
+            // doesn't count against their deadlines
+            uint32_t currentTimeUs = BoardGetElapsedTimeUs();
+
+            for (size_t i = 0; i < NumTasks; i++)
+                LastStartTimesUs[Tasks[i].ProfilerTask] = currentTimeUs;
+        }
+    }
+
+    BoardExitCritical(state);
+}
+#endif
+
+void SchedulerInit(const struct SchedulerTask *tasks, size_t numTasks)
+{
+    uint32_t currentTimeUs = BoardGetElapsedTimeUs();
+
+    Tasks = tasks;
+    NumTasks = numTasks;
+
+    memset(Stats, 0, sizeof(Stats));
+    for (size_t i = 0; i < NumTasks; i++)
+    {
+        Stats[Tasks[i].ProfilerTask].DeadlineUs = Tasks[i].DeadlineUs;
+        LastStartTimesUs[Tasks[i].ProfilerTask] = currentTimeUs;
+    }
+}
+
+void SchedulerRun()
+{
+    ProfilerLoopStart();
+    BoardWorkPendingClear();
+
+    for (size_t i = 0; i < NumTasks; i++)
+    {
+        // Catch up on any deadline that arrived while the previous task ran
+        if (i > 0)
+            RunOverdueTasks(i);
+
+        RunTask(&Tasks[i]);
+    }
+
+    ProfilerLoopEnd();
+
+#ifdef ENABLE_SLEEP_WHEN_IDLE
+    SleepUntilWork();
+#endif
+}
+
+bool SchedulerReadTaskStats(unsigned task, struct SchedulerTaskStats *stats, bool resetAfterRead)
+{
+    bool success = false;
+
+    for (size_t i = 0; i < NumTasks; i++)
+    {
+        if (Tasks[i].ProfilerTask == task)
+            success = true;
+    }
+
+    if (success)
+    {
+        *stats = Stats[task];
+
+        if (resetAfterRead)
+        {
+            Stats[task].Runs = 0;
+            Stats[task].Overruns = 0;
+            Stats[task].MaxIntervalUs = 0;
+        }
+    }
+
+    return success;
+}
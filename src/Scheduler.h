@@ -0,0 +1,115 @@
+/*
+Copyright 2021 Frank Jenner
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "Profiler.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** A task run by the main loop */
+struct SchedulerTask
+{
+    /** Runs the task, which must return as soon as it has no more work */
+    void (*Run)();
+
+    /**
+     * Gets how long the task can go without being run before it next has
+     * work to do (UINT32_MAX if none is scheduled), which bounds how long the
+     * core may sleep
+     */
+    uint32_t (*DelayUs)();
+
+    /**
+     * The longest the task should go between runs while the core is awake,
+     * in microseconds, or zero if it has no deadline. A task whose deadline
+     * arrives is run again between the other tasks, instead of waiting for
+     * the rest of the loop iteration. Runs that start after the deadline are
+     * counted as overruns.
+     */
+    uint32_t DeadlineUs;
+
+    /**
+     * The profiler task to which the run time is attributed, which also
+     * identifies the task in SchedulerReadTaskStats()
+     */
+    enum ProfilerTask ProfilerTask;
+};
+
+/** Scheduling statistics of a task */
+struct SchedulerTaskStats
+{
+    /** The task's deadline, in microseconds, or zero if it has none */
+    uint32_t DeadlineUs;
+
+    /** The number of times the task was run */
+    uint32_t Runs;
+
+    /** The number of runs that started after the task's deadline */
+    uint32_t Overruns;
+
+    /**
+     * The longest interval between the starts of consecutive runs, in
+     * microseconds, excluding any time spent asleep
+     */
+    uint32_t MaxIntervalUs;
+};
+
+/**
+ * Initializes the scheduler with the tasks to run, clearing all statistics
+ *
+ * @param[in] tasks The tasks, in priority order, which is also the order in
+ *                  which each loop iteration runs them. The table must remain
+ *                  valid for as long as the scheduler runs.
+ * @param[in] numTasks The number of tasks
+ */
+void SchedulerInit(const struct SchedulerTask *tasks, size_t numTasks);
+
+/**
+ * Runs one iteration of the main loop: runs every task in turn, running any
+ * task whose deadline has arrived again in between, and then sleeps until
+ * an interrupt occurs or a task's next work is due (if sleeping is enabled)
+ */
+void SchedulerRun();
+
+/**
+ * Reads the scheduling statistics of a task
+ *
+ * @param[in] task The profiler task identifying the task
+ * @param[out] stats The structure to populate with the statistics
+ * @param[in] resetAfterRead Whether to reset the statistics after reading
+ *
+ * @return Returns true on success or false if the task is not scheduled
+ */
+bool SchedulerReadTaskStats(unsigned task, struct SchedulerTaskStats *stats, bool resetAfterRead);
+
+#endif
@@ -0,0 +1,174 @@
+/*
+Copyright 2021 Frank Jenner
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "Sequencer.h"
+#include "boards/Board.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/** The time of each step, relative to the start of playback or of the loop */
+static uint32_t StepOffsetsUs[SEQUENCER_MAX_STEPS];
+
+/** The relay states written by each step */
+static uint8_t StepRelays[SEQUENCER_MAX_STEPS];
+
+/** The number of steps being played */
+static unsigned NumSteps;
+
+/** The index of the next step to apply */
+static unsigned NextStep;
+
+/** Whether to repeat the sequence until stopped */
+static bool Looping;
+
+/** The time between the starts of successive loops */
+static uint32_t PeriodUs;
+
+/** The time at which playback (or the current loop) started */
+static uint32_t StartTimeUs;
+
+/** Whether the sequence is playing */
+static volatile bool Running;
+
+/**
+ * Alarm callback which applies the steps that have become due and sets the
+ * alarm for the next step
+ *
+ * @param[in] timeUs The time for which the alarm was set
+ */
+static void SequencerAlarm(uint32_t timeUs)
+{
+    uint32_t nowUs = BoardGetElapsedTimeUs();
+    bool apply = false;
+    uint8_t relays = 0;
+
+    (void)timeUs;
+
+    // If the alarm went off late, several steps may be due at once, but only
+    // the last of them needs to be written
+    while (Running && (int32_t)(StartTimeUs + StepOffsetsUs[NextStep] - nowUs) <= 0)
+    {
+        relays = StepRelays[NextStep];
+        apply = true;
+
+        if (++NextStep == NumSteps)
+        {
+            NextStep = 0;
+
+            // Step times are always relative to the scheduled start of the
+            // loop, so lateness doesn't accumulate from one loop to the next
+            if (Looping)
+                StartTimeUs += PeriodUs;
+            else
+                Running = false;
+        }
+    }
+
+    if (apply)
+        BoardWriteRelays(relays);
+
+    if (Running)
+        BoardAlarmSet(BOARD_ALARM_SEQUENCER, StartTimeUs + StepOffsetsUs[NextStep], SequencerAlarm);
+}
+
+void SequencerInit()
+{
+    SequencerStop();
+    NumSteps = 0;
+}
+
+bool SequencerLoadStep(unsigned index, uint32_t offsetUs, uint8_t relays)
+{
+    bool success = false;
+
+    if (!Running && index < SEQUENCER_MAX_STEPS && offsetUs <= SEQUENCER_MAX_OFFSET_US)
+    {
+        StepOffsetsUs[index] = offsetUs;
+        StepRelays[index] = relays;
+        success = true;
+    }
+
+    return success;
+}
+
+bool SequencerStart(unsigned numSteps, bool loop, uint32_t periodUs)
+{
+    bool success = numSteps > 0 && numSteps <= SEQUENCER_MAX_STEPS;
+
+    // The loaded steps can't change while the sequence is playing, so stop it
+    // before checking them
+    SequencerStop();
+
+    for (unsigned i = 1; success && i < numSteps; i++)
+    {
+        uint32_t intervalUs = StepOffsetsUs[i] - StepOffsetsUs[i - 1];
+
+        if (StepOffsetsUs[i] < StepOffsetsUs[i - 1] ||
+            (intervalUs != 0 && intervalUs < SEQUENCER_MIN_INTERVAL_US))
+            success = false;
+    }
+
+    if (success && loop &&
+        (periodUs <= StepOffsetsUs[numSteps - 1] || periodUs > SEQUENCER_MAX_OFFSET_US ||
+         periodUs - StepOffsetsUs[numSteps - 1] + StepOffsetsUs[0] < SEQUENCER_MIN_INTERVAL_US))
+        success = false;
+
+    if (success)
+    {
+        uint32_t state = BoardEnterCritical();
+
+        NumSteps = numSteps;
+        NextStep = 0;
+        Looping = loop;
+        PeriodUs = periodUs;
+        StartTimeUs = BoardGetElapsedTimeUs();
+        Running = true;
+
+        BoardAlarmSet(BOARD_ALARM_SEQUENCER, StartTimeUs + StepOffsetsUs[0], SequencerAlarm);
+
+        BoardExitCritical(state);
+    }
+
+    return success;
+}
+
+void SequencerStop()
+{
+    uint32_t state = BoardEnterCritical();
+
+    Running = false;
+    BoardAlarmCancel(BOARD_ALARM_SEQUENCER);
+
+    BoardExitCritical(state);
+}
+
+bool SequencerIsRunning()
+{
+    return Running;
+}
@@ -0,0 +1,104 @@
+/*
+Copyright 2021 Frank Jenner
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef SEQUENCER_H
+#define SEQUENCER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** The maximum number of steps in a relay sequence */
+#define SEQUENCER_MAX_STEPS         128
+
+/** The longest supported step offset or loop period, in microseconds */
+#define SEQUENCER_MAX_OFFSET_US     0x7fffffff
+
+/**
+ * The shortest time between steps that fall due at different times (including
+ * from the last step of a loop to the first step of the next), in
+ * microseconds, which keeps the sequencer interrupt from starving the rest of
+ * the firmware
+ */
+#define SEQUENCER_MIN_INTERVAL_US   50
+
+/**
+ * Initialize the sequencer with an empty sequence and playback stopped
+ */
+void SequencerInit();
+
+/**
+ * Stores a step of the relay sequence. Steps cannot be changed while the
+ * sequence is playing.
+ *
+ * @param[in] index The index of the step
+ * @param[in] offsetUs The time at which to apply the step, in microseconds
+ *                     from the start of playback (or of each loop)
+ * @param[in] relays The relay states to write when the step is applied
+ *
+ * @return Returns true on success, or false if the index or offset is out of
+ *         range or the sequence is playing
+ */
+bool SequencerLoadStep(unsigned index, uint32_t offsetUs, uint8_t relays);
+
+/**
+ * Starts playing the first steps of the sequence, restarting playback if it
+ * is already in progress. Each step's relay states are written at its offset
+ * from the start of playback, timed from interrupt context independently of
+ * the main loop and of the USB host. Steps that become due together are
+ * applied with a single write.
+ *
+ * @param[in] numSteps The number of steps to play, which must have offsets in
+ *                     nondecreasing order, and each offset must either equal
+ *                     the previous one or follow it by at least
+ *                     SEQUENCER_MIN_INTERVAL_US
+ * @param[in] loop True to repeat the sequence until stopped, or false to play
+ *                 it once
+ * @param[in] periodUs When looping, the time between the starts of successive
+ *                     loops, which must be greater than the last step's
+ *                     offset, and leave at least SEQUENCER_MIN_INTERVAL_US
+ *                     between the last step of a loop and the first step of
+ *                     the next. Ignored when not looping.
+ *
+ * @return Returns true on success, or false if the arguments are invalid
+ */
+bool SequencerStart(unsigned numSteps, bool loop, uint32_t periodUs);
+
+/**
+ * Stops playback, leaving the relays in their current states
+ */
+void SequencerStop();
+
+/**
+ * Checks whether the sequence is playing
+ *
+ * @return Returns true if the sequence is playing, or false otherwise
+ */
+bool SequencerIsRunning();
+
+#endif
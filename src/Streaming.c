@@ -0,0 +1,191 @@
+/*
+Copyright 2021 Frank Jenner
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "Streaming.h"
+#include "EventCounter.h"
+#include "boards/Board.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#define US_PER_MS 1000
+
+/** The fields selected for streaming, or zero if streaming is disabled */
+static uint8_t ContentMask;
+
+/** The streaming period */
+static uint32_t PeriodUs;
+
+/** The time at which the next frame is due to be sampled */
+static uint32_t NextSampleTimeUs;
+
+/** Sequence number of the next frame to be sampled */
+static uint8_t Sequence;
+
+/** The frame waiting to be sent (if FrameLen is nonzero) */
+static uint8_t Frame[STREAMING_MAX_FRAME_SIZE];
+static size_t FrameLen;
+
+/**
+ * Appends a little-endian value to the frame
+ *
+ * @param[in] value The value to append
+ * @param[in] numBytes The number of bytes of @p value to append
+ */
+static void AppendToFrame(uint32_t value, unsigned numBytes)
+{
+    for (unsigned i = 0; i < numBytes; i++)
+    {
+        Frame[FrameLen++] = value & 0xff;
+        value >>= 8;
+    }
+}
+
+/**
+ * Samples the selected content into the frame buffer
+ */
+static void SampleFrame()
+{
+    struct StreamingSnapshot snapshot;
+
+    StreamingSnapshotTake(&snapshot, false);
+
+    FrameLen = 0;
+    AppendToFrame(Sequence, 1);
+    AppendToFrame(ContentMask, 1);
+
+    if (ContentMask & STREAMING_CONTENT_TIMESTAMP)
+        AppendToFrame(snapshot.TimeUs, 4);
+
+    if (ContentMask & STREAMING_CONTENT_INPUTS)
+        AppendToFrame(snapshot.Inputs, 1);
+
+    if (ContentMask & STREAMING_CONTENT_RELAYS)
+        AppendToFrame(snapshot.Relays, 1);
+
+    if (ContentMask & STREAMING_CONTENT_COUNTERS)
+    {
+        for (unsigned i = 0; i < EVENT_COUNTER_NUM_COUNTERS; i++)
+            AppendToFrame(snapshot.Counts[i], 4);
+    }
+
+    if (ContentMask & STREAMING_CONTENT_DEBOUNCED)
+        AppendToFrame(snapshot.DebouncedInputs, 1);
+}
+
+void StreamingInit()
+{
+    ContentMask = 0;
+    FrameLen = 0;
+}
+
+void StreamingTask()
+{
+    if (ContentMask != 0)
+    {
+        uint32_t currentTimeUs = BoardGetElapsedTimeUs();
+
+        if ((int32_t)(currentTimeUs - NextSampleTimeUs) >= 0)
+        {
+            if (FrameLen == 0)
+                SampleFrame();
+            else
+                BoardDebugPrint("%s: Dropped frame %u\r\n", __func__, Sequence);
+
+            Sequence++;
+            NextSampleTimeUs += PeriodUs;
+
+            // Don't try to catch up on periods that were missed entirely
+            if ((int32_t)(currentTimeUs - NextSampleTimeUs) >= 0)
+                NextSampleTimeUs = currentTimeUs + PeriodUs;
+        }
+    }
+}
+
+uint32_t StreamingTaskDelayUs()
+{
+    uint32_t delayUs = UINT32_MAX;
+
+    if (ContentMask != 0)
+    {
+        int32_t untilUs = NextSampleTimeUs - BoardGetElapsedTimeUs();
+        delayUs = untilUs > 0 ? (uint32_t)untilUs : 0;
+    }
+
+    return delayUs;
+}
+
+void StreamingConfigure(uint8_t contentMask, uint16_t periodMs)
+{
+    uint8_t trackedInputs = 0;
+
+    ContentMask = contentMask & STREAMING_CONTENT_ALL;
+    PeriodUs = (uint32_t)periodMs * US_PER_MS;
+    FrameLen = 0;
+
+    if (PeriodUs == 0)
+        ContentMask = 0;
+
+    // Falling edges must be debounced for the debounced state to be current
+    if (ContentMask & STREAMING_CONTENT_DEBOUNCED)
+        trackedInputs = EVENT_COUNTER_ALL_INPUTS;
+
+    EventCounterTrackInputs(EVENT_COUNTER_TRACKER_STREAMING, trackedInputs);
+
+    // Take the first sample right away
+    NextSampleTimeUs = BoardGetElapsedTimeUs();
+}
+
+size_t StreamingGetFrame(uint8_t *buf, size_t len)
+{
+    size_t ret = 0;
+
+    if (FrameLen > 0 && FrameLen <= len)
+    {
+        memcpy(buf, Frame, FrameLen);
+        ret = FrameLen;
+        FrameLen = 0;
+    }
+
+    return ret;
+}
+
+void StreamingSnapshotTake(struct StreamingSnapshot *snapshot, bool resetCounters)
+{
+    uint32_t state = BoardEnterCritical();
+
+    snapshot->TimeUs = BoardGetElapsedTimeUs();
+    snapshot->Relays = BoardReadRelays();
+    snapshot->Inputs = BoardReadDigitalInputs();
+    snapshot->DebouncedInputs = EventCounterDebouncedInputsGet();
+    snapshot->TrackedInputs = EventCounterTrackedInputsGet();
+    EventCounterReadAll(snapshot->Counts, resetCounters);
+
+    BoardExitCritical(state);
+}
@@ -0,0 +1,149 @@
+/*
+Copyright 2021 Frank Jenner
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef STREAMING_H
+#define STREAMING_H
+
+#include "EventCounter.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Content mask bits selecting the fields included in each streaming frame.
+ * Fields always appear in the frame in the order listed here.
+ */
+
+/** The time of the sample (uint32_t, microseconds since power-up) */
+#define STREAMING_CONTENT_TIMESTAMP 0x01
+
+/** The digital inputs (uint8_t, same layout as the "PI" command) */
+#define STREAMING_CONTENT_INPUTS    0x02
+
+/** The relay port (uint8_t, same layout as the "PK" command) */
+#define STREAMING_CONTENT_RELAYS    0x04
+
+/** All of the event counters (uint32_t each, counter 0 first) */
+#define STREAMING_CONTENT_COUNTERS  0x08
+
+/**
+ * The debounced inputs (uint8_t, same layout as the "PI" command). All of the
+ * inputs are tracked while this field is selected.
+ */
+#define STREAMING_CONTENT_DEBOUNCED 0x10
+
+#define STREAMING_CONTENT_ALL       0x1f
+
+/**
+ * The largest possible frame: the sequence number and content mask header,
+ * plus every field
+ */
+#define STREAMING_MAX_FRAME_SIZE    (2 + 4 + 1 + 1 + EVENT_COUNTER_NUM_COUNTERS * 4 + 1)
+
+/** The state of the board, all sampled at the same instant */
+struct StreamingSnapshot
+{
+    /** The time of the sample, in microseconds since power-up */
+    uint32_t TimeUs;
+
+    /** The relay port, as returned by BoardReadRelays() */
+    uint8_t Relays;
+
+    /** The raw digital inputs, as returned by BoardReadDigitalInputs() */
+    uint8_t Inputs;
+
+    /** The debounced inputs, valid only for the bits in TrackedInputs */
+    uint8_t DebouncedInputs;
+
+    /** The inputs whose debounced state is being kept up to date */
+    uint8_t TrackedInputs;
+
+    /** The event counts */
+    uint32_t Counts[EVENT_COUNTER_NUM_COUNTERS];
+};
+
+/**
+ * Initializes the streaming module, with streaming disabled
+ */
+void StreamingInit();
+
+/**
+ * Samples the selected content into a new frame each time the streaming
+ * period elapses. If the previous frame has not yet been taken for sending by
+ * the time the next one is due, the new sample is dropped; the host can
+ * detect this from a gap in the frame sequence numbers.
+ */
+void StreamingTask();
+
+/**
+ * Gets how long StreamingTask() can go without being called before the next
+ * frame is due
+ *
+ * @return Returns the delay in microseconds, or UINT32_MAX if streaming is
+ *         disabled
+ */
+uint32_t StreamingTaskDelayUs();
+
+/**
+ * Arms or disarms streaming. A frame is produced every @p periodMs
+ * milliseconds containing the fields selected by @p contentMask, starting
+ * immediately. A period or content mask of zero disarms streaming.
+ *
+ * @param[in] contentMask Bitwise OR of STREAMING_CONTENT_* flags
+ * @param[in] periodMs The streaming period, in milliseconds
+ */
+void StreamingConfigure(uint8_t contentMask, uint16_t periodMs);
+
+/**
+ * Takes the most recently sampled frame, if one is waiting to be sent. Frames
+ * are little-endian and consist of a sequence number byte (incremented for
+ * every period, including dropped ones), the content mask byte, and then the
+ * selected fields in the order of the STREAMING_CONTENT_* flags.
+ *
+ * @param[out] buf The buffer to populate with the frame
+ * @param[in] len The length of the provided buffer
+ *
+ * @return Returns the length of the frame, or zero if no frame is waiting
+ */
+size_t StreamingGetFrame(uint8_t *buf, size_t len);
+
+/**
+ * Samples the state of the board in a single critical section, so that no
+ * edge, relay change or counter update can land between the fields. This is
+ * what each streaming frame is built from.
+ *
+ * @param[out] snapshot The snapshot to populate
+ * @param[in] resetCounters Whether to reset the event counters in the same
+ *                          critical section, so no event is lost or counted
+ *                          twice across consecutive snapshots
+ */
+void StreamingSnapshotTake(struct StreamingSnapshot *snapshot, bool resetCounters);
+
+#endif
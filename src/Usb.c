@@ -31,10 +31,236 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "tusb.h"
 #include "boards/Board.h"
 #include "AduProtocol.h"
+#include "Streaming.h"
+#include "InputNotify.h"
+#include "ExtProtocol.h"
 
 /** The normal ADU commands/responses use HID report ID 1 */
 #define REPORT_ID_ADU_CMD_RSP   1
 
+/**
+ * Streaming frames are pushed to the host on input report ID 3, and the host
+ * configures streaming with output report ID 3, whose payload is the content
+ * mask followed by the 16-bit little-endian period in milliseconds
+ */
+#define REPORT_ID_STREAMING     3
+#define STREAMING_CONFIG_SIZE   3
+
+/**
+ * Extended protocol commands are received on output report ID 4, and their
+ * responses are sent back as fragmented frames on input report ID 4
+ */
+#define REPORT_ID_EXT_CMD_RSP   4
+
+/**
+ * Input change notifications are pushed to the host on input report ID 5, and
+ * the host configures them with output report ID 5, whose payload is the
+ * input mask followed by the 16-bit little-endian minimum interval between
+ * notifications in milliseconds
+ */
+#define REPORT_ID_INPUT_NOTIFY  5
+#define INPUT_NOTIFY_CONFIG_SIZE 3
+
+/** The SET_IDLE duration is given in units of 4ms */
+#define IDLE_RATE_UNIT_MS       4
+
+/** The number of payload bytes in each report (excluding the report ID) */
+#define REPORT_PAYLOAD_SIZE     (CFG_TUD_HID_EP_BUFSIZE - 1)
+
+/**
+ * Binary frames are sent as a series of fragments, one per report. The first
+ * payload byte of each fragment holds the fragment index, with the most
+ * significant bit set on the final fragment of the frame.
+ */
+#define FRAGMENT_LAST           0x80
+#define FRAGMENT_DATA_SIZE      (REPORT_PAYLOAD_SIZE - 1)
+
+/** The size of the largest binary frame sent as a series of fragments */
+#define FRAGMENTED_FRAME_MAX_SIZE \
+    (STREAMING_MAX_FRAME_SIZE > EXT_PROTOCOL_MAX_RESPONSE_SIZE ? \
+     STREAMING_MAX_FRAME_SIZE : EXT_PROTOCOL_MAX_RESPONSE_SIZE)
+
+/** A binary frame in the process of being sent as a series of fragments */
+struct FragmentedFrame
+{
+    uint8_t ReportId;
+    uint8_t Data[FRAGMENTED_FRAME_MAX_SIZE];
+    size_t Len;
+    size_t Offset;
+    uint8_t FragmentIndex;
+};
+
+/** The streaming frame currently being sent to the host (if Len nonzero) */
+static struct FragmentedFrame StreamingTx = { .ReportId = REPORT_ID_STREAMING };
+
+/** The extended protocol response currently being sent (if Len nonzero) */
+static struct FragmentedFrame ExtTx = { .ReportId = REPORT_ID_EXT_CMD_RSP };
+
+#ifdef ENABLE_DEFERRED_COMMANDS
+/** The number of received reports that can await processing (a power of 2) */
+#define RX_QUEUE_SIZE           4
+
+/** An output report received from the host, awaiting processing */
+struct ReceivedReport
+{
+    uint8_t ReportId;
+    uint8_t Len;
+    uint8_t Data[REPORT_PAYLOAD_SIZE];
+};
+
+/**
+ * Output reports received from the host, oldest first. Only
+ * tud_hid_set_report_cb() advances the head, and only UsbTask() advances the
+ * tail. Both run in the main loop (the callback from within tud_task()), so
+ * neither needs a lock. The indices run freely and are reduced modulo the
+ * ring size on access.
+ */
+static struct ReceivedReport RxQueue[RX_QUEUE_SIZE];
+static volatile uint8_t RxQueueHead;
+static volatile uint8_t RxQueueTail;
+#endif
+
+/** The number of output reports dropped because the receive queue was full */
+static uint32_t DroppedReports;
+
+/**
+ * Sends the next fragment of a binary frame to the host
+ *
+ * @pre The HID IN endpoint is ready to accept a report
+ *
+ * @param[in,out] frame The frame to send, which is marked as empty once the
+ *                      final fragment has been sent
+ */
+static void SendNextFragment(struct FragmentedFrame *frame)
+{
+    uint8_t report[REPORT_PAYLOAD_SIZE] = { 0 };
+    size_t remaining = frame->Len - frame->Offset;
+    size_t chunkLen = remaining < FRAGMENT_DATA_SIZE ? remaining : FRAGMENT_DATA_SIZE;
+
+    report[0] = frame->FragmentIndex;
+    if (chunkLen == remaining)
+        report[0] |= FRAGMENT_LAST;
+
+    memcpy(&report[1], &frame->Data[frame->Offset], chunkLen);
+
+    if (tud_hid_report(frame->ReportId, report, sizeof(report)))
+    {
+        frame->Offset += chunkLen;
+        frame->FragmentIndex++;
+
+        if (frame->Offset == frame->Len)
+        {
+            frame->Len = 0;
+            frame->Offset = 0;
+            frame->FragmentIndex = 0;
+        }
+    }
+}
+
+/**
+ * Sends the next pending report back to the host, provided that the HID IN
+ * endpoint is free. Queued ADU responses (e.g. the responses to a batch of
+ * commands) are sent one report at a time and take priority over input change
+ * notifications, then extended protocol responses, and then streaming frames.
+ * Both kinds of binary frame are sent one fragment at a time.
+ */
+static void SendPendingReports()
+{
+    if (tud_hid_ready())
+    {
+        uint8_t rspBuf[CFG_TUD_HID_EP_BUFSIZE];
+        int rspLen = AduProtocolPopResponse(rspBuf, sizeof(rspBuf));
+
+        if (rspLen > 0)
+        {
+            BoardDebugPrint("%s: Sending response with length %d\r\n", __func__, rspLen);
+            // Pad the remainder of the report with zeros
+            memset(&rspBuf[rspLen], 0, sizeof(rspBuf) - rspLen);
+            tud_hid_report(REPORT_ID_ADU_CMD_RSP, rspBuf, sizeof(rspBuf));
+        }
+        else if ((rspLen = InputNotifyGetReport(rspBuf, sizeof(rspBuf))) > 0)
+        {
+            memset(&rspBuf[rspLen], 0, sizeof(rspBuf) - rspLen);
+            tud_hid_report(REPORT_ID_INPUT_NOTIFY, rspBuf, REPORT_PAYLOAD_SIZE);
+        }
+        else
+        {
+            // Pick up a new extended protocol response once the last one is
+            // sent. A streaming frame already in progress is paused, rather
+            // than restarted, until the response has been sent.
+            if (ExtTx.Len == 0)
+                ExtTx.Len = ExtProtocolGetResponse(ExtTx.Data, sizeof(ExtTx.Data));
+
+            if (ExtTx.Len > 0)
+            {
+                SendNextFragment(&ExtTx);
+            }
+            else
+            {
+                // Start on the next streaming frame once the last one is sent
+                if (StreamingTx.Len == 0)
+                    StreamingTx.Len = StreamingGetFrame(StreamingTx.Data, sizeof(StreamingTx.Data));
+
+                if (StreamingTx.Len > 0)
+                    SendNextFragment(&StreamingTx);
+            }
+        }
+    }
+}
+
+/**
+ * Processes an output report received from the host, passing its payload to
+ * the appropriate protocol handler
+ *
+ * @param[in] reportId The report ID
+ * @param[in] buffer The report payload data (excluding the report ID)
+ * @param[in] bufsize The length of the report payload data
+ */
+static void ProcessOutputReport(uint8_t reportId, uint8_t const* buffer, uint16_t bufsize)
+{
+    BoardDebugPrint("%s(reportId=%u, buffer[0]=0x%02x, bufsize=%u)\r\n", __func__, (unsigned)reportId, buffer[0], bufsize);
+
+    if (reportId == REPORT_ID_STREAMING)
+    {
+        if (bufsize >= STREAMING_CONFIG_SIZE)
+        {
+            // Restart the stream with a fresh frame under the new settings
+            StreamingTx.Len = 0;
+            StreamingTx.Offset = 0;
+            StreamingTx.FragmentIndex = 0;
+
+            StreamingConfigure(buffer[0], buffer[1] | (buffer[2] << 8));
+        }
+    }
+    else if (reportId == REPORT_ID_INPUT_NOTIFY)
+    {
+        if (bufsize >= INPUT_NOTIFY_CONFIG_SIZE)
+        {
+            InputNotifyConfigure(buffer[0], buffer[1] | (buffer[2] << 8));
+            SendPendingReports();
+        }
+    }
+    else if (reportId == REPORT_ID_ADU_CMD_RSP)
+    {
+        // Send the report payload to the ADU command processor
+        bool success = AduProtocolProcessCommand(buffer, bufsize);
+
+        if (!success)
+        {
+            BoardDebugPrint("%s: Failed processing command %.*s\r\n", __func__, (int)bufsize, buffer);
+        }
+
+        // Even a partially failed batch may have responses to send back
+        SendPendingReports();
+    }
+    else if (reportId == REPORT_ID_EXT_CMD_RSP)
+    {
+        // Failed commands still elicit a response carrying the status
+        ExtProtocolProcessCommand(buffer, bufsize);
+        SendPendingReports();
+    }
+}
+
 /**
  * TinyUSB callback invoked when receiving a GET_REPORT control request. The
  * implementation should respond by either populating the buffer data and
@@ -57,7 +283,7 @@ uint16_t tud_hid_get_report_cb(uint8_t report_id, hid_report_type_t report_type,
         report_id == REPORT_ID_ADU_CMD_RSP)
     {
         // Get the response to the last command
-        ret = AduProtocolGetResponse(buffer, sizeof(reqlen));
+        ret = AduProtocolGetResponse(buffer, reqlen);
 
         // Zero-pad the remainder of the report if not filled completely
         if (ret < reqlen)
@@ -66,6 +292,19 @@ uint16_t tud_hid_get_report_cb(uint8_t report_id, hid_report_type_t report_type,
             ret = reqlen;
         }
     }
+    else if (report_type == HID_REPORT_TYPE_INPUT &&
+             report_id == REPORT_ID_INPUT_NOTIFY)
+    {
+        // Get the current state of the watched inputs, leaving any pending
+        // notification to be sent as usual
+        ret = InputNotifyReadState(buffer, reqlen);
+
+        if (ret > 0 && ret < reqlen)
+        {
+            memset(&buffer[ret], 0, reqlen - ret);
+            ret = reqlen;
+        }
+    }
 
     return ret;
 }
@@ -76,14 +315,18 @@ uint16_t tud_hid_get_report_cb(uint8_t report_id, hid_report_type_t report_type,
  * request. The request can instead respond with a STALL if the function is
  * overridden and returns false.
  *
+ * Only the input change notifications are periodic in the HID sense, so the
+ * idle rate applies to them: while enabled, a notification is repeated after
+ * the idle duration even if no inputs have changed.
+ *
  * @param[in] idle_rate The duration, in 4ms increments, between reports
  *
  * @return Returns true if the request is honored or false to STALL the request
  */
 bool tud_hid_set_idle_cb(uint8_t idle_rate)
 {
-    // Behave like the ADU218 and STALL any SET_IDLE requests
-    return false;
+    InputNotifyIdleSet((uint32_t)idle_rate * IDLE_RATE_UNIT_MS);
+    return true;
 }
 
 /**
@@ -102,8 +345,6 @@ bool tud_hid_set_idle_cb(uint8_t idle_rate)
  */
 void tud_hid_set_report_cb(uint8_t report_id, hid_report_type_t report_type, uint8_t const* buffer, uint16_t bufsize)
 {
-    BoardDebugPrint("tud_hid_set_report_cb(report_id=%u, report_type=%u, buffer[0]=0x%02x, bufsize=%u)\r\n", (unsigned)report_id, (unsigned)report_type, buffer[0], bufsize);
-
     // If this was really an OUT transfer on the interrupt endpoint, extract
     // the report ID and adjust the interpretation of the other parameters
     if (report_type == HID_REPORT_TYPE_INVALID)
@@ -114,31 +355,35 @@ void tud_hid_set_report_cb(uint8_t report_id, hid_report_type_t report_type, uin
         bufsize--;
     }
 
-    // We only handle output report ID one
-    if (report_type == HID_REPORT_TYPE_OUTPUT &&
-        report_id == REPORT_ID_ADU_CMD_RSP)
+    if (report_type != HID_REPORT_TYPE_OUTPUT)
     {
-        // Send the report payload to the ADU command processor
-        bool success = AduProtocolProcessCommand(buffer, bufsize);
-
-        if (!success)
+        BoardDebugPrint("%s: Unsupported report type\r\n", __func__);
+    }
+    else
+    {
+#ifdef ENABLE_DEFERRED_COMMANDS
+        // Leave the processing to the main loop, so that control returns to
+        // the USB stack as quickly as possible. Processing a report here to
+        // make room would stall the main loop for just the bursts the queue
+        // is meant to absorb, so a report that doesn't fit is dropped and
+        // counted instead.
+        if ((uint8_t)(RxQueueHead - RxQueueTail) == RX_QUEUE_SIZE)
         {
-            BoardDebugPrint("%s: Failed processing command %s\r\n", __func__, buffer);
+            BoardDebugPrint("%s: Receive queue full, dropping report %u\r\n", __func__, (unsigned)report_id);
+            DroppedReports++;
         }
         else
         {
-            // See whether there is a response to send back to the host
-            uint8_t rspBuf[CFG_TUD_HID_EP_BUFSIZE];
-            int rspLen = AduProtocolGetResponse(rspBuf, sizeof(rspBuf));
+            struct ReceivedReport *report = &RxQueue[RxQueueHead % RX_QUEUE_SIZE];
 
-            if (rspLen > 0)
-            {
-                BoardDebugPrint("%s: Sending response with length %d\r\n", __func__, rspLen);
-                // Pad the remainder of the report with zeros
-                memset(&rspBuf[rspLen], 0, sizeof(rspBuf) - rspLen);
-                tud_hid_report(REPORT_ID_ADU_CMD_RSP, rspBuf, sizeof(rspBuf));
-            }
+            report->ReportId = report_id;
+            report->Len = bufsize < sizeof(report->Data) ? bufsize : sizeof(report->Data);
+            memcpy(report->Data, buffer, report->Len);
+            RxQueueHead++;
         }
+#else
+        ProcessOutputReport(report_id, buffer, bufsize);
+#endif
     }
 }
 
@@ -150,4 +395,41 @@ void UsbInit()
 void UsbTask()
 {
     tud_task();
-}
\ No newline at end of file
+
+#ifdef ENABLE_DEFERRED_COMMANDS
+    // Process at most one received report per pass through the main loop, so
+    // that a burst of commands can't starve the other tasks
+    if (RxQueueTail != RxQueueHead)
+    {
+        const struct ReceivedReport *report = &RxQueue[RxQueueTail % RX_QUEUE_SIZE];
+
+        ProcessOutputReport(report->ReportId, report->Data, report->Len);
+        RxQueueTail++;
+    }
+#endif
+
+    SendPendingReports();
+}
+
+uint32_t UsbTaskDelayUs()
+{
+    uint32_t delayUs = UINT32_MAX;
+
+#ifdef ENABLE_DEFERRED_COMMANDS
+    // Keep going until every received report has been processed
+    if (RxQueueTail != RxQueueHead)
+        delayUs = 0;
+#endif
+
+    return delayUs;
+}
+
+uint32_t UsbReadDroppedReports(bool resetAfterRead)
+{
+    uint32_t ret = DroppedReports;
+
+    if (resetAfterRead)
+        DroppedReports = 0;
+
+    return ret;
+}
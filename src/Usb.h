@@ -30,6 +30,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef USB_H
 #define USB_H
 
+#include <stdint.h>
+#include <stdbool.h>
+
 /**
  * Initialize the USB subsystem for use, including registering interrupts etc.
  * It is assumed that the USB subsystem will queue any work triggered by
@@ -39,8 +42,29 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 void UsbInit();
 
 /**
- * Task for servicing any outstanding work that was queued up from interrupts
+ * Task for servicing any outstanding work that was queued up from interrupts,
+ * including the processing of reports received from the host
  */
 void UsbTask();
 
+/**
+ * Gets how long UsbTask() can go without being called before it has work to
+ * do, aside from work signaled by the USB interrupt
+ *
+ * @return Returns the delay in microseconds, or UINT32_MAX if the task has no
+ *         pending work
+ */
+uint32_t UsbTaskDelayUs();
+
+/**
+ * Gets the number of output reports that were dropped because they arrived
+ * while the queue of reports awaiting processing was full. Reports are never
+ * dropped when they are processed directly within the USB stack's callback.
+ *
+ * @param[in] resetAfterRead True to reset the count after reading it
+ *
+ * @return Returns the number of dropped reports
+ */
+uint32_t UsbReadDroppedReports(bool resetAfterRead);
+
 #endif
\ No newline at end of file
@@ -36,6 +36,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #define LANGID_ENGLISH      0x0409
 
+// Full-speed interrupt endpoints can be polled every 1 to 255 ms
+#if USB_DESCRIPTORS_POLL_INTERVAL_MS < 1 || USB_DESCRIPTORS_POLL_INTERVAL_MS > 255
+#error "USB_DESCRIPTORS_POLL_INTERVAL_MS must be between 1 and 255"
+#endif
+
 /**
  * The device descriptor
  */
@@ -125,7 +130,7 @@ static const uint8_t HID_REPORT_DESCRIPTOR[] =
 
     HID_COLLECTION_END,
     
-    // Collection for "streaming" reports (report ID 3; unused on this device)
+    // Collection for "streaming" reports (report ID 3; periodic state frames)
     HID_USAGE        ( 0x03                       ),
     HID_COLLECTION   ( HID_COLLECTION_APPLICATION ),
 
@@ -147,6 +152,54 @@ static const uint8_t HID_REPORT_DESCRIPTOR[] =
         HID_REPORT_COUNT  ( CFG_TUD_HID_EP_BUFSIZE - 1             ),
         HID_OUTPUT        ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE ),
 
+    HID_COLLECTION_END,
+
+    // Collection for extended command/response reports (report ID 4; binary)
+    HID_USAGE        ( 0x04                       ),
+    HID_COLLECTION   ( HID_COLLECTION_APPLICATION ),
+
+        // Input report
+        HID_USAGE         ( 0xb0                                   ),
+        HID_REPORT_ID     ( 4                                      )
+        HID_USAGE         ( 0xb1                                   ),
+        HID_LOGICAL_MIN   ( 0x00                                   ),
+        HID_LOGICAL_MAX_N ( 0xff, 2                                ),
+        HID_REPORT_SIZE   ( 8                                      ),
+        HID_REPORT_COUNT  ( CFG_TUD_HID_EP_BUFSIZE - 1             ),
+        HID_INPUT         ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE ),
+
+        // Output report
+        HID_USAGE         ( 0xb2                                   ),
+        HID_LOGICAL_MIN   ( 0x00                                   ),
+        HID_LOGICAL_MAX_N ( 0xff, 2                                ),
+        HID_REPORT_SIZE   ( 8                                      ),
+        HID_REPORT_COUNT  ( CFG_TUD_HID_EP_BUFSIZE - 1             ),
+        HID_OUTPUT        ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE ),
+
+    HID_COLLECTION_END,
+
+    // Collection for input change notification reports (report ID 5; binary)
+    HID_USAGE        ( 0x05                       ),
+    HID_COLLECTION   ( HID_COLLECTION_APPLICATION ),
+
+        // Input report
+        HID_USAGE         ( 0xb3                                   ),
+        HID_REPORT_ID     ( 5                                      )
+        HID_USAGE         ( 0xb4                                   ),
+        HID_LOGICAL_MIN   ( 0x00                                   ),
+        HID_LOGICAL_MAX_N ( 0xff, 2                                ),
+        HID_REPORT_SIZE   ( 8                                      ),
+        HID_REPORT_COUNT  ( CFG_TUD_HID_EP_BUFSIZE - 1             ),
+        HID_INPUT         ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE ),
+
+        // Output report
+        HID_USAGE         ( 0xb5                                   ),
+        HID_LOGICAL_MIN   ( 0x00                                   ),
+        HID_LOGICAL_MAX_N ( 0xff, 2                                ),
+        HID_REPORT_SIZE   ( 8                                      ),
+        HID_REPORT_COUNT  ( CFG_TUD_HID_EP_BUFSIZE - 1             ),
+        HID_OUTPUT        ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE ),
+
     HID_COLLECTION_END
 };
 
@@ -189,7 +242,7 @@ static const uint8_t CONFIGURATION_DESCRIPTOR[] =
         0x01,               // HID interrupt OUT endpoint address
         0x01 | TUSB_DIR_IN_MASK, // HID interrupt IN endpoint address
         CFG_TUD_HID_EP_BUFSIZE, // HID interrupt endpoint packet size
-        10                  // Interrupt endpoint service interval in ms
+        USB_DESCRIPTORS_POLL_INTERVAL_MS // Interrupt endpoint service interval in ms
     )
 };
 
@@ -28,8 +28,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "Watchdog.h"
+#include "Sequencer.h"
 #include "boards/Board.h"
+#include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
 /** The time at which the watchdog was last kicked */
 static uint32_t LastKickTimeUs;
@@ -37,42 +40,113 @@ static uint32_t LastKickTimeUs;
 /** The watchdog timeout period. A period of zero means watchdog is disabled */
 static uint32_t WatchdogTimeoutPeriodUs;
 
+/** The timeout statistics */
+static struct WatchdogStats Stats;
+
+/** Set when a timeout has occurred but has not yet been reported */
+static volatile bool TripPending;
+
+/**
+ * Called from interrupt context at the timeout deadline to disable the
+ * watchdog timer and open all the relays (stopping any sequence that would
+ * close them again)
+ *
+ * @param[in] timeUs The timeout deadline
+ */
+static void HandleTimeout(uint32_t timeUs)
+{
+    uint32_t latencyUs;
+
+    WatchdogTimeoutPeriodUs = WATCHDOG_TIMEOUT_DISABLED;
+    SequencerStop();
+    BoardWriteRelays(0);
+
+    latencyUs = BoardGetElapsedTimeUs() - timeUs;
+
+    Stats.Trips++;
+    Stats.LastTripLatencyUs = latencyUs;
+    if (latencyUs > Stats.MaxTripLatencyUs)
+        Stats.MaxTripLatencyUs = latencyUs;
+
+    TripPending = true;
+}
+
 void WatchdogInit()
 {
     // Disable the watchdog timer by default
-    WatchdogTimeoutPeriodUs = WATCHDOG_TIMEOUT_DISABLED;
+    WatchdogTimeoutSet(WATCHDOG_TIMEOUT_DISABLED);
+
+    memset(&Stats, 0, sizeof(Stats));
+    TripPending = false;
 }
 
 void WatchdogTask()
 {
-    // If the watchdog is enabled
-    if (WatchdogTimeoutPeriodUs != WATCHDOG_TIMEOUT_DISABLED)
+    if (TripPending)
     {
-        uint32_t currentTimeUs = BoardGetElapsedTimeUs();
-
-        // If the watchdog timed out, disable the watchdog timer and open all
-        // the relays
-        if (currentTimeUs - LastKickTimeUs > WatchdogTimeoutPeriodUs)
-        {
-            WatchdogTimeoutPeriodUs = WATCHDOG_TIMEOUT_DISABLED;
-            BoardWriteRelays(0);
-
-            BoardDebugPrint("%s: Watchdog timed out!\r\n", __func__);
-        }
+        TripPending = false;
+        BoardDebugPrint("%s: Watchdog timed out %u us late!\r\n", __func__, (unsigned)Stats.LastTripLatencyUs);
     }
 }
 
+uint32_t WatchdogTaskDelayUs()
+{
+    return TripPending ? 0 : UINT32_MAX;
+}
+
 void WatchdogKick()
 {
-    LastKickTimeUs = BoardGetElapsedTimeUs();
+    uint32_t state = BoardEnterCritical();
+    uint32_t currentTimeUs = BoardGetElapsedTimeUs();
+
+    // Once the deadline has passed, the timeout is already pending (or in
+    // progress in a lower priority context) and must not be pushed back
+    if (WatchdogTimeoutPeriodUs != WATCHDOG_TIMEOUT_DISABLED &&
+        currentTimeUs - LastKickTimeUs < WatchdogTimeoutPeriodUs)
+    {
+        BoardAlarmSet(BOARD_ALARM_WATCHDOG, currentTimeUs + WatchdogTimeoutPeriodUs, HandleTimeout);
+    }
+
+    LastKickTimeUs = currentTimeUs;
+
+    BoardExitCritical(state);
 }
 
-void WatchdogTimeoutSet(uint32_t timeoutUs)
+bool WatchdogTimeoutSet(uint32_t timeoutUs)
 {
-    WatchdogTimeoutPeriodUs = timeoutUs;
+    bool success = false;
+
+    if (timeoutUs <= WATCHDOG_MAX_TIMEOUT_US)
+    {
+        uint32_t state = BoardEnterCritical();
+
+        WatchdogTimeoutPeriodUs = timeoutUs;
+        LastKickTimeUs = BoardGetElapsedTimeUs();
+
+        if (timeoutUs != WATCHDOG_TIMEOUT_DISABLED)
+            BoardAlarmSet(BOARD_ALARM_WATCHDOG, LastKickTimeUs + timeoutUs, HandleTimeout);
+        else
+            BoardAlarmCancel(BOARD_ALARM_WATCHDOG);
+
+        BoardExitCritical(state);
+        success = true;
+    }
+
+    return success;
 }
 
 uint32_t WatchdogTimeoutGet()
 {
     return WatchdogTimeoutPeriodUs;
-}
\ No newline at end of file
+}
+
+void WatchdogReadStats(struct WatchdogStats *stats, bool resetAfterRead)
+{
+    uint32_t state = BoardEnterCritical();
+
+    *stats = Stats;
+    if (resetAfterRead)
+        memset(&Stats, 0, sizeof(Stats));
+
+    BoardExitCritical(state);
+}
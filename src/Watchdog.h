@@ -30,32 +30,68 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef WATCHDOG_H
 #define WATCHDOG_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
 /** Treat a watchdog timeout of zero as "watchdog disabled" */
 #define WATCHDOG_TIMEOUT_DISABLED 0
 
+/** The longest supported watchdog timeout, in microseconds */
+#define WATCHDOG_MAX_TIMEOUT_US 0x7fffffff
+
+/** Watchdog timeout statistics */
+struct WatchdogStats
+{
+    /** The number of times the watchdog timed out */
+    uint32_t Trips;
+
+    /**
+     * The delay between the most recent timeout deadline and the relays
+     * being opened, in microseconds
+     */
+    uint32_t LastTripLatencyUs;
+
+    /** The longest delay between a timeout deadline and the relays opening */
+    uint32_t MaxTripLatencyUs;
+};
+
 /**
  * Initialize the watchdog with default values
  */
 void WatchdogInit();
 
 /**
- * Should be called periodically to check for and process a watchdog timeout
+ * Should be called periodically to report any watchdog timeout. The timeout
+ * itself is processed from interrupt context at the deadline, independently
+ * of the main loop.
  */
 void WatchdogTask();
 
 /**
- * Kicks the watchdog to restart the timeout counter
+ * Gets how long WatchdogTask() can go without being called before it has
+ * work to do, given that a timeout is only reported once its interrupt has
+ * woken the main loop
+ *
+ * @return Returns the delay in microseconds, or UINT32_MAX if there is no
+ *         scheduled work
+ */
+uint32_t WatchdogTaskDelayUs();
+
+/**
+ * Kicks the watchdog to restart the timeout counter. A kick that arrives
+ * after the deadline has passed does not prevent the timeout.
  */
 void WatchdogKick();
 
 /**
- * Sets the watchdog timeout period
+ * Sets the watchdog timeout period and restarts the timeout counter
+ *
+ * @param[in] timeoutUs The timeout period, in microseconds, or
+ *                      WATCHDOG_TIMEOUT_DISABLED to disable the watchdog
  *
- * @param[in] timeoutUs The timeout period, in microseconds
+ * @return Returns true on success, or false if the timeout is too long
  */
-void WatchdogTimeoutSet(uint32_t timeoutUs);
+bool WatchdogTimeoutSet(uint32_t timeoutUs);
 
 /**
  * Gets the watchdog timeout period
@@ -64,4 +100,12 @@ void WatchdogTimeoutSet(uint32_t timeoutUs);
  */
 uint32_t WatchdogTimeoutGet();
 
+/**
+ * Reads the watchdog timeout statistics
+ *
+ * @param[out] stats The structure to populate with the statistics
+ * @param[in] resetAfterRead Whether to reset the statistics after reading
+ */
+void WatchdogReadStats(struct WatchdogStats *stats, bool resetAfterRead);
+
 #endif
\ No newline at end of file
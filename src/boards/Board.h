@@ -2,6 +2,8 @@
 #define BOARD_H
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
 
 /**
  * Performs board-specific initialization. This generally includes setting up
@@ -19,6 +21,13 @@ void BoardInit();
  */
 uint32_t BoardGetElapsedTimeUs();
 
+/*
+ * The relay functions may be called from any context, including interrupt
+ * handlers. Each change is applied to the relays in a single write, and only
+ * affects the relays it selects, so changes made concurrently from different
+ * contexts are never lost.
+ */
+
 /**
  * Sets the state of the 8 relays, where the provided value represents that of
  * the protocol-level "PORTK" abstraction.
@@ -27,9 +36,32 @@ uint32_t BoardGetElapsedTimeUs();
  */
 void BoardWriteRelays(uint8_t relayState);
 
+/**
+ * Sets the state of some of the relays, leaving the others alone
+ *
+ * @param mask The relays to change, using the "PORTK" layout
+ * @param relayState The desired state of the selected relays
+ */
+void BoardWriteRelaysMasked(uint8_t mask, uint8_t relayState);
+
+/**
+ * Closes some of the relays, leaving the others alone
+ *
+ * @param relays The relays to close, using the "PORTK" layout
+ */
+void BoardSetRelays(uint8_t relays);
+
+/**
+ * Opens some of the relays, leaving the others alone
+ *
+ * @param relays The relays to open, using the "PORTK" layout
+ */
+void BoardClearRelays(uint8_t relays);
+
 /**
  * Reads the state of the 8 relays, corresponding to the protocol-level "PORTK"
- * abstraction.
+ * abstraction. This is the state most recently written, which is kept in
+ * memory so that reading it doesn't need to access the hardware.
  *
  * @return Returns the "PORTK" relays state
  */
@@ -45,6 +77,215 @@ uint8_t BoardReadRelays();
  */
 uint8_t BoardReadDigitalInputs();
 
+/**
+ * Callback invoked from interrupt context when edges are detected on the
+ * digital input lines. If an input pulsed too briefly for the interrupt to
+ * respond to each edge separately, both of its edges are reported at once.
+ *
+ * @param risingEdges The inputs on which a rising edge was detected, using
+ *                    the same bit layout as BoardReadDigitalInputs()
+ * @param fallingEdges The inputs on which a falling edge was detected (only
+ *                     those selected by BoardInputFallingEdgesSet())
+ * @param timeUs The time at which the edges were detected, in the same time
+ *               base as BoardGetElapsedTimeUs()
+ */
+typedef void (*BoardInputEdgeCallback)(uint8_t risingEdges, uint8_t fallingEdges, uint32_t timeUs);
+
+/**
+ * Registers a callback to be invoked from interrupt context whenever an edge
+ * occurs on any of the 8 digital input lines, and enables the edge
+ * interrupts. Passing NULL disables the edge interrupts.
+ *
+ * @param callback The function to call upon edges, or NULL
+ */
+void BoardInputEdgeCallbackSet(BoardInputEdgeCallback callback);
+
+/**
+ * Selects the digital inputs on which falling edges are detected, in addition
+ * to the rising edges that are always detected. None are selected by default,
+ * since every detected edge costs an interrupt.
+ *
+ * @param inputs The inputs on which to detect falling edges, using the same
+ *               bit layout as BoardReadDigitalInputs()
+ */
+void BoardInputFallingEdgesSet(uint8_t inputs);
+
+/**
+ * One-shot alarms that invoke a callback from interrupt context at a precise
+ * time, independently of the main loop. Each alarm has its own hardware
+ * compare channel, and is owned by a single module.
+ */
+enum BoardAlarm
+{
+    /** Used by the relay pulse module */
+    BOARD_ALARM_RELAY_PULSE,
+
+    /** Used by the relay sequencer */
+    BOARD_ALARM_SEQUENCER,
+
+    /** Used by the watchdog timeout */
+    BOARD_ALARM_WATCHDOG,
+
+    BOARD_NUM_ALARMS
+};
+
+/**
+ * Callback invoked from interrupt context when an alarm goes off
+ *
+ * @param timeUs The time for which the alarm was set
+ */
+typedef void (*BoardAlarmCallback)(uint32_t timeUs);
+
+/**
+ * Sets an alarm to go off at the specified time, replacing any earlier
+ * setting of the same alarm. If the time has already passed, the alarm goes
+ * off immediately. The alarm goes off only once, but the callback may set it
+ * again.
+ *
+ * @param alarm The alarm to set
+ * @param timeUs The time at which to invoke the callback, in the same time
+ *               base as BoardGetElapsedTimeUs(). This must be less than 2^31
+ *               microseconds in the future.
+ * @param callback The function to call when the alarm goes off
+ */
+void BoardAlarmSet(enum BoardAlarm alarm, uint32_t timeUs, BoardAlarmCallback callback);
+
+/**
+ * Cancels an alarm, if it has not already gone off
+ *
+ * @param alarm The alarm to cancel
+ */
+void BoardAlarmCancel(enum BoardAlarm alarm);
+
+/** Interrupt timing measurements reported to the profiling callback */
+enum BoardProfileEvent
+{
+    /** The time spent servicing a USB interrupt */
+    BOARD_PROFILE_USB_ISR_DURATION,
+
+    /**
+     * The delay between a periodic interrupt becoming pending and its handler
+     * starting, which grows whenever interrupts are held off (e.g. by
+     * critical sections or by other interrupt handlers)
+     */
+    BOARD_PROFILE_ISR_ENTRY_LATENCY
+};
+
+/**
+ * Callback invoked from interrupt context with interrupt timing measurements
+ *
+ * @param event The kind of measurement
+ * @param valueUs The measured time, in microseconds
+ */
+typedef void (*BoardProfileCallback)(enum BoardProfileEvent event, uint32_t valueUs);
+
+/**
+ * Registers a callback to be invoked from interrupt context with interrupt
+ * timing measurements. Passing NULL stops the measurements.
+ *
+ * @param callback The function to call with each measurement, or NULL
+ */
+void BoardProfileCallbackSet(BoardProfileCallback callback);
+
+/** Passed to BoardSleep() to sleep until the next interrupt, however long */
+#define BOARD_SLEEP_FOREVER 0xffffffff
+
+/**
+ * Clears the flag that is set by every interrupt (USB, input edge or wakeup
+ * timer) that may have left work for the main loop to do
+ */
+void BoardWorkPendingClear();
+
+/**
+ * Checks whether any interrupt that may have left work for the main loop has
+ * occurred since the last call to BoardWorkPendingClear()
+ *
+ * @return Returns true if work may be pending
+ */
+bool BoardWorkPendingGet();
+
+/**
+ * Puts the core to sleep until an interrupt occurs or until the specified
+ * time has elapsed, whichever comes first. Since interrupts are disabled, an
+ * interrupt that became pending before the call still ends the sleep right
+ * away, and its handler runs once the critical section is exited. Any
+ * periodic tick that leaves no work for the main loop is paused while asleep.
+ *
+ * @pre Called from within a critical section (see BoardEnterCritical())
+ *
+ * @param maxSleepUs The longest time to sleep, in microseconds, or
+ *                   BOARD_SLEEP_FOREVER to sleep until the next interrupt
+ */
+void BoardSleep(uint32_t maxSleepUs);
+
+#ifdef ENABLE_INPUT_CAPTURE
+/** The highest sample rate supported by BoardCaptureStart() */
+#define BOARD_CAPTURE_MAX_RATE_HZ 1000000
+
+/**
+ * Function called from interrupt context to read the new samples out of the
+ * capture ring buffer with BoardCaptureRead()
+ */
+typedef void (*BoardCaptureCallback)();
+
+/**
+ * Starts sampling all 8 digital inputs at a fixed rate into a ring buffer
+ * filled by the hardware, discarding any samples from an earlier capture.
+ * The sample rate may be rounded to the nearest rate the hardware supports.
+ * The callback is called from interrupt context every time the ring buffer
+ * fills halfway, so the samples are read out in time regardless of how busy
+ * the main loop is.
+ *
+ * @param sampleRateHz The sample rate, up to BOARD_CAPTURE_MAX_RATE_HZ
+ * @param callback The function to call to read out the samples
+ *
+ * @return Returns true on success, or false if the rate is unsupported
+ */
+bool BoardCaptureStart(uint32_t sampleRateHz, BoardCaptureCallback callback);
+
+/**
+ * Requests a call to the capture callback from its interrupt context, to read
+ * out the samples taken since the ring buffer last filled halfway (e.g. when
+ * sampling slowly)
+ */
+void BoardCaptureFlush();
+
+/**
+ * Stops sampling the digital inputs
+ */
+void BoardCaptureStop();
+
+/**
+ * Removes the oldest samples from the ring buffer. Must only be called from
+ * the capture callback. If the ring buffer wasn't read out in time, the
+ * oldest samples are overwritten and counted as lost.
+ *
+ * @param samples The array to populate with the samples, using the same bit
+ *                layout as BoardReadDigitalInputs()
+ * @param maxSamples The maximum number of samples to remove
+ * @param lost The number of samples lost since the previous call
+ *
+ * @return The number of samples removed
+ */
+size_t BoardCaptureRead(uint8_t *samples, size_t maxSamples, uint32_t *lost);
+#endif
+
+/**
+ * Enters a critical section by disabling interrupts. Critical sections may be
+ * nested, provided that each call is paired with a call to BoardExitCritical()
+ * passing the value returned by the corresponding call to this function.
+ *
+ * @return Returns the previous interrupt state, to be restored on exit
+ */
+uint32_t BoardEnterCritical();
+
+/**
+ * Exits a critical section entered by BoardEnterCritical()
+ *
+ * @param state The value returned by the matching BoardEnterCritical() call
+ */
+void BoardExitCritical(uint32_t state);
+
 /**
  * Print debug logging output in a board-specific manner
  *
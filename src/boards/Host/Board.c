@@ -0,0 +1,356 @@
+/*
+Copyright 2021 Frank Jenner
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "boards/Board.h"
+#include "HostBoard.h"
+
+#ifdef ENABLE_UART_DEBUG
+#include <stdio.h>
+#include <stdarg.h>
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Host-native implementation of the board layer, used for simulating and
+ * profiling the portable firmware modules on a development machine. Time is
+ * entirely virtual and only moves when HostBoardAdvanceTimeUs() is called, so
+ * runs are deterministic and repeatable regardless of the host's load.
+ */
+
+/** The virtual elapsed time since board initialization */
+static uint32_t ElapsedTimeUs;
+
+/** The in-memory "PORTK" relay port */
+static uint8_t RelayState;
+
+/** The in-memory digital input lines */
+static uint8_t DigitalInputs;
+
+/** The function to call upon edges on the digital inputs, if any */
+static BoardInputEdgeCallback InputEdgeCallback;
+
+/** The inputs on which falling edges are detected */
+static uint8_t FallingEdgeInputs;
+
+/** The function to call with interrupt timing measurements, if any */
+static BoardProfileCallback ProfileCallback;
+
+/** The time and callback of each alarm (if the callback is not NULL) */
+static uint32_t AlarmTimesUs[BOARD_NUM_ALARMS];
+static BoardAlarmCallback AlarmCallbacks[BOARD_NUM_ALARMS];
+
+#ifdef ENABLE_INPUT_CAPTURE
+/** The number of samples the simulated capture ring buffer holds */
+#define CAPTURE_RING_SIZE 128
+
+/** The simulated capture ring buffer and its state */
+static uint8_t CaptureRing[CAPTURE_RING_SIZE];
+static bool Capturing;
+static uint32_t CaptureRateHz;
+static uint32_t CaptureStartTimeUs;
+
+/** The number of samples written to and read from the ring buffer */
+static uint32_t CaptureWritten;
+static uint32_t CaptureRead;
+
+/** The function to call to read out the samples */
+static BoardCaptureCallback CaptureCallback;
+
+/** Whether the samples are being taken, which the callback must not recurse */
+static bool CaptureSampling;
+
+/**
+ * Calls the capture callback, unless it is already running
+ */
+static void CallCaptureCallback()
+{
+    if (!CaptureSampling)
+    {
+        CaptureSampling = true;
+        CaptureCallback();
+        CaptureSampling = false;
+    }
+}
+
+/**
+ * Simulates the sampling hardware by taking every sample that is due by the
+ * current virtual time, including calling the callback every time the ring
+ * buffer fills halfway. Since the inputs only change when the simulation sets
+ * them, this only needs to be done before the inputs change, when time
+ * advances, or when the samples are read.
+ */
+static void TakeCaptureSamples()
+{
+    if (Capturing && !CaptureSampling)
+    {
+        // The first sample is taken at the start time
+        uint32_t due = (uint64_t)(ElapsedTimeUs - CaptureStartTimeUs) * CaptureRateHz / 1000000 + 1;
+
+        CaptureSampling = true;
+
+        // The callback may stop the capture
+        while (Capturing && CaptureWritten != due)
+        {
+            CaptureRing[CaptureWritten++ % CAPTURE_RING_SIZE] = DigitalInputs;
+
+            if (CaptureWritten % (CAPTURE_RING_SIZE / 2) == 0)
+                CaptureCallback();
+        }
+
+        CaptureSampling = false;
+    }
+}
+#endif
+
+void BoardInit()
+{
+    ElapsedTimeUs = 0;
+    RelayState = 0;
+    DigitalInputs = 0;
+    InputEdgeCallback = NULL;
+    FallingEdgeInputs = 0;
+    ProfileCallback = NULL;
+
+    for (unsigned i = 0; i < BOARD_NUM_ALARMS; i++)
+        AlarmCallbacks[i] = NULL;
+
+#ifdef ENABLE_INPUT_CAPTURE
+    Capturing = false;
+#endif
+}
+
+uint32_t BoardGetElapsedTimeUs()
+{
+    return ElapsedTimeUs;
+}
+
+void BoardWriteRelays(uint8_t relayState)
+{
+    RelayState = relayState;
+}
+
+void BoardWriteRelaysMasked(uint8_t mask, uint8_t relayState)
+{
+    RelayState = (RelayState & ~mask) | (relayState & mask);
+}
+
+void BoardSetRelays(uint8_t relays)
+{
+    RelayState |= relays;
+}
+
+void BoardClearRelays(uint8_t relays)
+{
+    RelayState &= ~relays;
+}
+
+uint8_t BoardReadRelays()
+{
+    return RelayState;
+}
+
+uint8_t BoardReadDigitalInputs()
+{
+    return DigitalInputs;
+}
+
+void BoardInputEdgeCallbackSet(BoardInputEdgeCallback callback)
+{
+    InputEdgeCallback = callback;
+}
+
+void BoardInputFallingEdgesSet(uint8_t inputs)
+{
+    FallingEdgeInputs = inputs;
+}
+
+void BoardAlarmSet(enum BoardAlarm alarm, uint32_t timeUs, BoardAlarmCallback callback)
+{
+    AlarmTimesUs[alarm] = timeUs;
+    AlarmCallbacks[alarm] = callback;
+}
+
+void BoardAlarmCancel(enum BoardAlarm alarm)
+{
+    AlarmCallbacks[alarm] = NULL;
+}
+
+void BoardProfileCallbackSet(BoardProfileCallback callback)
+{
+    // There are no real interrupts to measure, so the callback is never used
+    ProfileCallback = callback;
+}
+
+void BoardWorkPendingClear()
+{
+}
+
+bool BoardWorkPendingGet()
+{
+    return false;
+}
+
+void BoardSleep(uint32_t maxSleepUs)
+{
+    // Virtual time only moves under the control of the simulation, so there
+    // is nothing to wait for
+}
+
+uint32_t BoardEnterCritical()
+{
+    // The simulation is single threaded, and "interrupts" are only ever
+    // raised synchronously by the HostBoard*() simulation controls
+    return 0;
+}
+
+void BoardExitCritical(uint32_t state)
+{
+}
+
+#ifdef ENABLE_INPUT_CAPTURE
+bool BoardCaptureStart(uint32_t sampleRateHz, BoardCaptureCallback callback)
+{
+    bool success = sampleRateHz > 0 && sampleRateHz <= BOARD_CAPTURE_MAX_RATE_HZ;
+
+    if (success)
+    {
+        Capturing = true;
+        CaptureRateHz = sampleRateHz;
+        CaptureStartTimeUs = ElapsedTimeUs;
+        CaptureWritten = 0;
+        CaptureRead = 0;
+        CaptureCallback = callback;
+    }
+
+    return success;
+}
+
+void BoardCaptureStop()
+{
+    TakeCaptureSamples();
+    Capturing = false;
+}
+
+void BoardCaptureFlush()
+{
+    TakeCaptureSamples();
+
+    if (Capturing)
+        CallCaptureCallback();
+}
+
+size_t BoardCaptureRead(uint8_t *samples, size_t maxSamples, uint32_t *lost)
+{
+    size_t count = 0;
+
+    TakeCaptureSamples();
+
+    *lost = 0;
+    if (CaptureWritten - CaptureRead > CAPTURE_RING_SIZE)
+    {
+        *lost = CaptureWritten - CaptureRead - CAPTURE_RING_SIZE;
+        CaptureRead += *lost;
+    }
+
+    while (count < maxSamples && CaptureRead != CaptureWritten)
+        samples[count++] = CaptureRing[CaptureRead++ % CAPTURE_RING_SIZE];
+
+    return count;
+}
+#endif
+
+#ifdef ENABLE_UART_DEBUG
+int BoardDebugPrint(const char *format, ...)
+{
+    va_list va;
+    va_start(va, format);
+    int len = vfprintf(stderr, format, va);
+    va_end(va);
+
+    return len;
+}
+#endif
+
+void HostBoardAdvanceTimeUs(uint32_t deltaUs)
+{
+    uint32_t endTimeUs = ElapsedTimeUs + deltaUs;
+
+    // Simulate the alarm interrupts, in order, at the times they go off
+    for (;;)
+    {
+        int earliest = -1;
+
+        for (unsigned i = 0; i < BOARD_NUM_ALARMS; i++)
+        {
+            if (AlarmCallbacks[i] != NULL &&
+                (int32_t)(endTimeUs - AlarmTimesUs[i]) >= 0 &&
+                (earliest < 0 || (int32_t)(AlarmTimesUs[earliest] - AlarmTimesUs[i]) > 0))
+            {
+                earliest = i;
+            }
+        }
+
+        if (earliest < 0)
+            break;
+
+        BoardAlarmCallback callback = AlarmCallbacks[earliest];
+        AlarmCallbacks[earliest] = NULL;
+
+        // Alarms that were set in the past go off at the current time
+        if ((int32_t)(AlarmTimesUs[earliest] - ElapsedTimeUs) > 0)
+            ElapsedTimeUs = AlarmTimesUs[earliest];
+
+        callback(AlarmTimesUs[earliest]);
+    }
+
+    ElapsedTimeUs = endTimeUs;
+
+#ifdef ENABLE_INPUT_CAPTURE
+    TakeCaptureSamples();
+#endif
+}
+
+void HostBoardSetDigitalInputs(uint8_t inputs)
+{
+    uint8_t risingEdges = inputs & ~DigitalInputs;
+    uint8_t fallingEdges = ~inputs & DigitalInputs & FallingEdgeInputs;
+
+#ifdef ENABLE_INPUT_CAPTURE
+    // Sample the inputs up until the moment they change
+    TakeCaptureSamples();
+#endif
+
+    DigitalInputs = inputs;
+
+    // Simulate the edge interrupt
+    if ((risingEdges | fallingEdges) != 0 && InputEdgeCallback != NULL)
+        InputEdgeCallback(risingEdges, fallingEdges, ElapsedTimeUs);
+}
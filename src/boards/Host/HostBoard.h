@@ -0,0 +1,65 @@
+/*
+Copyright 2021 Frank Jenner
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef HOST_BOARD_H
+#define HOST_BOARD_H
+
+#include <stdint.h>
+
+/*
+ * Simulation controls for the host-native board implementation. These have
+ * no counterpart on real hardware; they allow a host program (e.g. the
+ * benchmark) to stand in for the physical world by driving the virtual time
+ * base and the state of the digital input lines.
+ */
+
+/**
+ * Advances the virtual time base returned by BoardGetElapsedTimeUs(). Like
+ * the hardware timer, the virtual time is a free-running 32-bit value that
+ * rolls over to zero upon overflow. Any alarms that come due are invoked
+ * synchronously, in order, with the virtual time set to each alarm's time.
+ * (An alarm set for a time that has already passed goes off upon the next
+ * call, which may advance the time by zero.)
+ *
+ * @param[in] deltaUs The amount of time to advance, in microseconds
+ */
+void HostBoardAdvanceTimeUs(uint32_t deltaUs);
+
+/**
+ * Sets the state of the 8 simulated digital input lines, using the same bit
+ * layout as BoardReadDigitalInputs(). If an input edge callback is registered,
+ * it is invoked synchronously for any resulting rising edges (and falling
+ * edges, if selected), as though the edge interrupt had fired at the current
+ * virtual time.
+ *
+ * @param[in] inputs The new state of the digital input lines
+ */
+void HostBoardSetDigitalInputs(uint8_t inputs);
+
+#endif
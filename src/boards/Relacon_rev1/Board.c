@@ -61,6 +61,9 @@
                              PIN_RELAY_4 | PIN_RELAY_5 | \
                              PIN_RELAY_6 | PIN_RELAY_7)
 
+// The upper half of a GPIO BSRR register resets the pins
+#define GPIO_BSRR_RESET_SHIFT 16
+
 // Input pins
 #define PIN_INPUT_BANK1_0   GPIO_PIN_0
 #define PIN_INPUT_BANK1_1   GPIO_PIN_1
@@ -86,6 +89,9 @@
 
 #define DEBUG_CONSOLE_BAUD_RATE 115200
 
+// The core (and SysTick) clock frequency, in MHz
+#define CORE_CLOCK_MHZ      48
+
 #ifdef ENABLE_UART_DEBUG
 static UART_HandleTypeDef UartHandle =
 {
@@ -108,7 +114,7 @@ static TIM_HandleTypeDef TimerHandle =
     .Instance = TIM2,
     .Init =
     {
-        .Prescaler = 48 - 1, // Scale the 48MHz clock source to a 1us period
+        .Prescaler = CORE_CLOCK_MHZ - 1, // Scale the 48MHz clock source to a 1us period
         .CounterMode = TIM_COUNTERMODE_UP,
         .Period = 0xffffffff,
         .ClockDivision = TIM_CLOCKDIVISION_DIV1,
@@ -116,15 +122,156 @@ static TIM_HandleTypeDef TimerHandle =
     }
 };
 
+/** The function to call with interrupt timing measurements, if any */
+static BoardProfileCallback ProfileCallback;
+
+/**
+ * The state of the relays, as last written. The relay pins are PA0 to PA7, so
+ * this is also their ODR state.
+ */
+static volatile uint8_t RelayState;
+
+/** Set by any interrupt that may have left work for the main loop */
+static volatile bool WorkPending;
+
+/** The timer compare channel used by an alarm */
+struct AlarmChannel
+{
+    uint32_t Channel;
+    uint32_t Flag;
+    uint32_t Interrupt;
+    uint32_t Event;
+};
+
+/**
+ * The timer compare channels used by each alarm. (Channel 1 is reserved for
+ * waking the core from BoardSleep().)
+ */
+static const struct AlarmChannel ALARM_CHANNELS[BOARD_NUM_ALARMS] =
+{
+    [BOARD_ALARM_RELAY_PULSE] = { TIM_CHANNEL_2, TIM_FLAG_CC2, TIM_IT_CC2, TIM_EVENTSOURCE_CC2 },
+    [BOARD_ALARM_SEQUENCER]   = { TIM_CHANNEL_3, TIM_FLAG_CC3, TIM_IT_CC3, TIM_EVENTSOURCE_CC3 },
+    [BOARD_ALARM_WATCHDOG]    = { TIM_CHANNEL_4, TIM_FLAG_CC4, TIM_IT_CC4, TIM_EVENTSOURCE_CC4 },
+};
+
+/** The function to call when each alarm goes off */
+static BoardAlarmCallback AlarmCallbacks[BOARD_NUM_ALARMS];
+
+#ifdef ENABLE_INPUT_CAPTURE
+/** The number of samples in the capture ring buffers */
+#define CAPTURE_RING_SIZE   128
+
+/**
+ * Samples this close to the DMA write position may be overwritten while they
+ * are being copied out, so they are treated as lost
+ */
+#define CAPTURE_RING_MARGIN 16
+
+/**
+ * The capture ring buffers, filled by DMA from the input data registers on
+ * every TIM3 period. Since the inputs span two ports, each sample is split
+ * across the two buffers.
+ */
+static uint8_t CaptureBank1[CAPTURE_RING_SIZE];
+static uint8_t CaptureBank2[CAPTURE_RING_SIZE];
+
+/** The number of times the bank 1 DMA channel has wrapped around its buffer */
+static volatile uint32_t CaptureWraps;
+
+/** The number of samples read out of the ring buffers */
+static uint32_t CaptureRead;
+
+/** The function to call to read out the samples */
+static BoardCaptureCallback CaptureCallback;
+#endif
+
 /**
  * The SysTick interrupt handler. This overrides the default handler in the
  * startup assembly file. This one simply calls the HAL_IncTick() function in
  * ST's HAL framework, which they require in order for functionality such as
  * HAL_Delay() to work properly.
+ *
+ * Since the SysTick interrupt becomes pending at a precisely known time (when
+ * the counter reloads), it also serves as a probe for interrupt entry
+ * latency: the counter has been counting down from the reload value ever
+ * since the interrupt became pending.
  */
 void SysTick_Handler(void)
 {
+    uint32_t latencyCycles = SysTick->LOAD - SysTick->VAL;
+
     HAL_IncTick();
+
+    if (ProfileCallback != NULL)
+        ProfileCallback(BOARD_PROFILE_ISR_ENTRY_LATENCY, latencyCycles / CORE_CLOCK_MHZ);
+}
+
+/** The function to call upon edges on the digital inputs, if any */
+static BoardInputEdgeCallback InputEdgeCallback;
+
+/** The inputs on which falling edges are detected */
+static uint8_t FallingEdgeInputs;
+
+/** The state of the inputs as of the last edge interrupt */
+static uint8_t LastInputs;
+
+/**
+ * Common handler for the EXTI interrupts of all the digital input lines.
+ * Conveniently, the EXTI line numbers match the pin numbers, so the pending
+ * bits map onto the "PORTA"/"PORTB" input layout exactly as the input data
+ * register bits do in BoardReadDigitalInputs().
+ */
+static void HandleInputEdgeInterrupt()
+{
+    uint32_t timeUs = __HAL_TIM_GET_COUNTER(&TimerHandle);
+
+    uint32_t pending = EXTI->PR & (PIN_INPUT_BANK1_ALL | PIN_INPUT_BANK2_ALL);
+
+    // Pending bits are cleared by writing ones to them
+    EXTI->PR = pending;
+
+    // Shift the PORTA8 bit into the gap from the missing PORTB2 bit
+    uint8_t edges = (pending & PIN_INPUT_BANK1_ALL) |
+                    ((pending & PIN_INPUT_BANK2_ALL) >> 6);
+    uint8_t inputs = BoardReadDigitalInputs();
+
+    // Inputs that only detect rising edges must have risen. For the others,
+    // the change in state tells which way the input went, and an unchanged
+    // state means it pulsed and came back before the interrupt was serviced.
+    uint8_t risingEdges = edges & (~FallingEdgeInputs | ~LastInputs | inputs);
+    uint8_t fallingEdges = edges & FallingEdgeInputs & (LastInputs | ~inputs);
+
+    LastInputs = inputs;
+
+    if ((risingEdges | fallingEdges) != 0 && InputEdgeCallback != NULL)
+        InputEdgeCallback(risingEdges, fallingEdges, timeUs);
+
+    WorkPending = true;
+}
+
+/**
+ * EXTI interrupt handler for lines 0 and 1 (inputs PORTA0 and PORTA1)
+ */
+void EXTI0_1_IRQHandler(void)
+{
+    HandleInputEdgeInterrupt();
+}
+
+/**
+ * EXTI interrupt handler for lines 2 and 3 (input PORTA3)
+ */
+void EXTI2_3_IRQHandler(void)
+{
+    HandleInputEdgeInterrupt();
+}
+
+/**
+ * EXTI interrupt handler for lines 4 through 15 (inputs PORTB0 through
+ * PORTB3, and PORTA2 on line 8)
+ */
+void EXTI4_15_IRQHandler(void)
+{
+    HandleInputEdgeInterrupt();
 }
 
 /**
@@ -134,7 +281,41 @@ void SysTick_Handler(void)
  */
 void USB_IRQHandler(void)
 {
+    uint32_t startTimeUs = __HAL_TIM_GET_COUNTER(&TimerHandle);
+
     tud_int_handler(0);
+
+    if (ProfileCallback != NULL)
+        ProfileCallback(BOARD_PROFILE_USB_ISR_DURATION, __HAL_TIM_GET_COUNTER(&TimerHandle) - startTimeUs);
+
+    WorkPending = true;
+}
+
+/**
+ * The TIM2 interrupt handler. The capture/compare 1 interrupt is only used to
+ * wake the core from BoardSleep() at the requested time, while the other
+ * channels' interrupts invoke the alarm callbacks.
+ */
+void TIM2_IRQHandler(void)
+{
+    __HAL_TIM_CLEAR_FLAG(&TimerHandle, TIM_FLAG_CC1);
+
+    for (unsigned i = 0; i < BOARD_NUM_ALARMS; i++)
+    {
+        const struct AlarmChannel *alarm = &ALARM_CHANNELS[i];
+
+        if (__HAL_TIM_GET_FLAG(&TimerHandle, alarm->Flag) &&
+            __HAL_TIM_GET_IT_SOURCE(&TimerHandle, alarm->Interrupt))
+        {
+            // Alarms only go off once, unless the callback sets them again
+            __HAL_TIM_DISABLE_IT(&TimerHandle, alarm->Interrupt);
+            __HAL_TIM_CLEAR_FLAG(&TimerHandle, alarm->Flag);
+
+            AlarmCallbacks[i](__HAL_TIM_GET_COMPARE(&TimerHandle, alarm->Channel));
+        }
+    }
+
+    WorkPending = true;
 }
 
 static void InitClocks()
@@ -177,6 +358,7 @@ static void InitClocks()
     __HAL_RCC_GPIOA_CLK_ENABLE(); // PORT_RELAYS, PORT_USART, and PORT_INPUT_BANK2
     __HAL_RCC_GPIOB_CLK_ENABLE(); // PORT_INPUT_BANK1
     __HAL_RCC_TIM2_CLK_ENABLE();
+    __HAL_RCC_SYSCFG_CLK_ENABLE(); // EXTI line to port mapping
     __HAL_RCC_USB_CLK_ENABLE();
 #ifdef ENABLE_UART_DEBUG
     __HAL_RCC_USART1_CLK_ENABLE();
@@ -185,7 +367,8 @@ static void InitClocks()
 
 static void InitPins()
 {
-    // Initialize GPIO output pins for relays
+    // Initialize GPIO output pins for relays, starting with them all open
+    BoardWriteRelays(0);
     GPIO_InitTypeDef gpioConfigRelays =
     {
         .Pin = PIN_RELAY_ALL,
@@ -195,11 +378,14 @@ static void InitPins()
     };
     HAL_GPIO_Init(PORT_RELAYS, &gpioConfigRelays);
 
-    // Initialize GPIO input pins
+    // Initialize GPIO input pins. The EXTI lines are routed to the inputs to
+    // detect rising edges (and falling edges once selected), but the
+    // interrupts stay disabled in the NVIC until an edge callback is
+    // registered.
     GPIO_InitTypeDef gpioConfigInputsBank1 =
     {
         .Pin = PIN_INPUT_BANK1_ALL,
-        .Mode = GPIO_MODE_INPUT,
+        .Mode = GPIO_MODE_IT_RISING,
         .Pull = GPIO_PULLDOWN,
         .Speed = GPIO_SPEED_FREQ_LOW,
     };
@@ -208,7 +394,7 @@ static void InitPins()
     GPIO_InitTypeDef gpioConfigInputsBank2 =
     {
         .Pin = PIN_INPUT_BANK2_ALL,
-        .Mode = GPIO_MODE_INPUT,
+        .Mode = GPIO_MODE_IT_RISING,
         .Pull = GPIO_PULLDOWN,
         .Speed = GPIO_SPEED_FREQ_LOW,
     };
@@ -242,6 +428,11 @@ static void InitPeripherals()
         for (;;);
     }
 
+    // The timer's compare interrupts wake the core from BoardSleep() and
+    // drive the alarms, which need to go off as close to on time as possible
+    HAL_NVIC_SetPriority(TIM2_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(TIM2_IRQn);
+
 #ifdef ENABLE_UART_DEBUG
     // Initialize UART
     if (HAL_UART_Init(&UartHandle) != HAL_OK)
@@ -268,12 +459,38 @@ uint32_t BoardGetElapsedTimeUs()
 
 void BoardWriteRelays(uint8_t relayState)
 {
-    LL_GPIO_WriteOutputPort(PORT_RELAYS, relayState);
+    BoardWriteRelaysMasked(PIN_RELAY_ALL, relayState);
+}
+
+void BoardWriteRelaysMasked(uint8_t mask, uint8_t relayState)
+{
+    // The relays share their port with other pins, so they are written
+    // through BSRR (whose lower half sets pins and upper half resets them)
+    // rather than by rewriting the whole ODR. The shadow state is updated in
+    // the same critical section, so it always matches the pins.
+    uint32_t setPins = (uint32_t)(relayState & mask);
+    uint32_t resetPins = (uint32_t)(~relayState & mask);
+    uint32_t state = BoardEnterCritical();
+
+    RelayState = (RelayState & ~mask) | setPins;
+    PORT_RELAYS->BSRR = setPins | (resetPins << GPIO_BSRR_RESET_SHIFT);
+
+    BoardExitCritical(state);
+}
+
+void BoardSetRelays(uint8_t relays)
+{
+    BoardWriteRelaysMasked(relays, PIN_RELAY_ALL);
+}
+
+void BoardClearRelays(uint8_t relays)
+{
+    BoardWriteRelaysMasked(relays, 0);
 }
 
 uint8_t BoardReadRelays()
 {
-    return LL_GPIO_ReadOutputPort(PORT_RELAYS) & PIN_RELAY_ALL;
+    return RelayState;
 }
 
 uint8_t BoardReadDigitalInputs()
@@ -288,6 +505,273 @@ uint8_t BoardReadDigitalInputs()
     return pinsInputBank1 | (pinsInputBank2 >> 6);
 }
 
+void BoardInputEdgeCallbackSet(BoardInputEdgeCallback callback)
+{
+    static const IRQn_Type INPUT_EDGE_IRQS[] =
+    {
+        EXTI0_1_IRQn,
+        EXTI2_3_IRQn,
+        EXTI4_15_IRQn
+    };
+
+    for (unsigned i = 0; i < sizeof(INPUT_EDGE_IRQS) / sizeof(INPUT_EDGE_IRQS[0]); i++)
+        HAL_NVIC_DisableIRQ(INPUT_EDGE_IRQS[i]);
+
+    InputEdgeCallback = callback;
+
+    if (callback != NULL)
+    {
+        // Discard any edges that occurred before the callback was registered
+        EXTI->PR = PIN_INPUT_BANK1_ALL | PIN_INPUT_BANK2_ALL;
+
+        // Edge timestamps are most accurate at the highest priority
+        for (unsigned i = 0; i < sizeof(INPUT_EDGE_IRQS) / sizeof(INPUT_EDGE_IRQS[0]); i++)
+        {
+            HAL_NVIC_ClearPendingIRQ(INPUT_EDGE_IRQS[i]);
+            HAL_NVIC_SetPriority(INPUT_EDGE_IRQS[i], 0, 0);
+            HAL_NVIC_EnableIRQ(INPUT_EDGE_IRQS[i]);
+        }
+    }
+}
+
+void BoardInputFallingEdgesSet(uint8_t inputs)
+{
+    // Shift the bit for the missing PORTB2 back out to PORTA8
+    uint32_t lines = (inputs & PIN_INPUT_BANK1_ALL) |
+                     ((inputs << 6) & PIN_INPUT_BANK2_ALL);
+    uint32_t state = BoardEnterCritical();
+
+    FallingEdgeInputs = inputs;
+    LastInputs = BoardReadDigitalInputs();
+    EXTI->FTSR = (EXTI->FTSR & ~(PIN_INPUT_BANK1_ALL | PIN_INPUT_BANK2_ALL)) | lines;
+
+    BoardExitCritical(state);
+}
+
+void BoardAlarmSet(enum BoardAlarm alarm, uint32_t timeUs, BoardAlarmCallback callback)
+{
+    const struct AlarmChannel *channel = &ALARM_CHANNELS[alarm];
+    uint32_t state = BoardEnterCritical();
+
+    AlarmCallbacks[alarm] = callback;
+
+    __HAL_TIM_DISABLE_IT(&TimerHandle, channel->Interrupt);
+    __HAL_TIM_SET_COMPARE(&TimerHandle, channel->Channel, timeUs);
+    __HAL_TIM_CLEAR_FLAG(&TimerHandle, channel->Flag);
+    __HAL_TIM_ENABLE_IT(&TimerHandle, channel->Interrupt);
+
+    // If the time has already come, the compare match may have been missed,
+    // so force the alarm to go off right away
+    if ((int32_t)(timeUs - __HAL_TIM_GET_COUNTER(&TimerHandle)) <= 0)
+        TimerHandle.Instance->EGR = channel->Event;
+
+    BoardExitCritical(state);
+}
+
+void BoardAlarmCancel(enum BoardAlarm alarm)
+{
+    const struct AlarmChannel *channel = &ALARM_CHANNELS[alarm];
+    uint32_t state = BoardEnterCritical();
+
+    __HAL_TIM_DISABLE_IT(&TimerHandle, channel->Interrupt);
+    __HAL_TIM_CLEAR_FLAG(&TimerHandle, channel->Flag);
+
+    BoardExitCritical(state);
+}
+
+void BoardProfileCallbackSet(BoardProfileCallback callback)
+{
+    ProfileCallback = callback;
+}
+
+void BoardWorkPendingClear()
+{
+    WorkPending = false;
+}
+
+bool BoardWorkPendingGet()
+{
+    return WorkPending;
+}
+
+void BoardSleep(uint32_t maxSleepUs)
+{
+    bool sleep = true;
+
+    if (maxSleepUs != BOARD_SLEEP_FOREVER)
+    {
+        uint32_t wakeTimeUs = __HAL_TIM_GET_COUNTER(&TimerHandle) + maxSleepUs;
+
+        __HAL_TIM_CLEAR_FLAG(&TimerHandle, TIM_FLAG_CC1);
+        __HAL_TIM_SET_COMPARE(&TimerHandle, TIM_CHANNEL_1, wakeTimeUs);
+        __HAL_TIM_ENABLE_IT(&TimerHandle, TIM_IT_CC1);
+
+        // If the counter already reached the wakeup time, the compare match
+        // may have been missed, so don't risk sleeping until the timer wraps
+        if ((int32_t)(wakeTimeUs - __HAL_TIM_GET_COUNTER(&TimerHandle)) <= 0)
+            sleep = false;
+    }
+
+    if (sleep)
+    {
+        // The 1 kHz SysTick interrupt would otherwise end every sleep within a
+        // millisecond without leaving any work, so it's paused while asleep.
+        // The HAL tick doesn't count the time spent asleep, which nothing
+        // relies on, and the entry latency probe only samples while awake.
+        SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+
+        __DSB();
+        __WFI();
+
+        SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+    }
+
+    __HAL_TIM_DISABLE_IT(&TimerHandle, TIM_IT_CC1);
+}
+
+#ifdef ENABLE_INPUT_CAPTURE
+/**
+ * The DMA channel 2 and 3 interrupt handler. Counts the wraps of the bank 1
+ * capture ring buffer, which is filled by channel 3, and reads out the
+ * samples whenever the buffer fills halfway (or a flush is requested).
+ */
+void DMA1_Channel2_3_IRQHandler(void)
+{
+    if ((DMA1->ISR & DMA_ISR_TCIF3) != 0)
+    {
+        DMA1->IFCR = DMA_IFCR_CTCIF3;
+        CaptureWraps++;
+    }
+
+    DMA1->IFCR = DMA_IFCR_CHTIF3;
+
+    if (CaptureCallback != NULL)
+        CaptureCallback();
+}
+
+/**
+ * Gets the total number of samples written to the capture ring buffers
+ *
+ * @return The number of samples written since the capture started
+ */
+static uint32_t CaptureWrittenGet()
+{
+    uint32_t state = BoardEnterCritical();
+    uint32_t wraps = CaptureWraps;
+    uint32_t position = CAPTURE_RING_SIZE - DMA1_Channel3->CNDTR;
+
+    // If the channel wrapped around but the interrupt hasn't counted it yet,
+    // the position already belongs to the next wrap
+    if ((DMA1->ISR & DMA_ISR_TCIF3) != 0 && position < CAPTURE_RING_SIZE / 2)
+        wraps++;
+
+    BoardExitCritical(state);
+
+    return wraps * CAPTURE_RING_SIZE + position;
+}
+
+bool BoardCaptureStart(uint32_t sampleRateHz, BoardCaptureCallback callback)
+{
+    bool success = sampleRateHz > 0 && sampleRateHz <= BOARD_CAPTURE_MAX_RATE_HZ;
+
+    if (success)
+    {
+        uint32_t periodCycles = (CORE_CLOCK_MHZ * 1000000 + sampleRateHz / 2) / sampleRateHz;
+
+        __HAL_RCC_DMA1_CLK_ENABLE();
+        __HAL_RCC_TIM3_CLK_ENABLE();
+
+        BoardCaptureStop();
+
+        CaptureWraps = 0;
+        CaptureRead = 0;
+        CaptureCallback = callback;
+
+        // Bank 1 is sampled by the timer update event, which is routed to DMA
+        // channel 3
+        DMA1_Channel3->CPAR = (uint32_t)&PORT_INPUTS_BANK1->IDR;
+        DMA1_Channel3->CMAR = (uint32_t)CaptureBank1;
+        DMA1_Channel3->CNDTR = CAPTURE_RING_SIZE;
+        DMA1_Channel3->CCR = DMA_CCR_PL_1 | DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_HTIE | DMA_CCR_TCIE | DMA_CCR_EN;
+
+        // Bank 2 is sampled one cycle earlier by the compare 1 event, which is
+        // routed to DMA channel 4. Only the second byte of its input data
+        // register (holding PORTA8) is needed.
+        DMA1_Channel4->CPAR = (uint32_t)&PORT_INPUTS_BANK2->IDR + 1;
+        DMA1_Channel4->CMAR = (uint32_t)CaptureBank2;
+        DMA1_Channel4->CNDTR = CAPTURE_RING_SIZE;
+        DMA1_Channel4->CCR = DMA_CCR_PL_1 | DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_EN;
+
+        HAL_NVIC_ClearPendingIRQ(DMA1_Channel2_3_IRQn);
+        HAL_NVIC_SetPriority(DMA1_Channel2_3_IRQn, 1, 0);
+        HAL_NVIC_EnableIRQ(DMA1_Channel2_3_IRQn);
+
+        TIM3->PSC = 0;
+        TIM3->ARR = periodCycles - 1;
+        TIM3->CCR1 = periodCycles - 1;
+        TIM3->CNT = 0;
+        TIM3->DIER = TIM_DIER_UDE | TIM_DIER_CC1DE;
+        TIM3->CR1 = TIM_CR1_CEN;
+    }
+
+    return success;
+}
+
+void BoardCaptureStop()
+{
+    TIM3->CR1 = 0;
+    TIM3->DIER = 0;
+
+    DMA1_Channel3->CCR = 0;
+    DMA1_Channel4->CCR = 0;
+    DMA1->IFCR = DMA_IFCR_CGIF3 | DMA_IFCR_CGIF4;
+
+    HAL_NVIC_DisableIRQ(DMA1_Channel2_3_IRQn);
+    HAL_NVIC_ClearPendingIRQ(DMA1_Channel2_3_IRQn);
+}
+
+void BoardCaptureFlush()
+{
+    HAL_NVIC_SetPendingIRQ(DMA1_Channel2_3_IRQn);
+}
+
+size_t BoardCaptureRead(uint8_t *samples, size_t maxSamples, uint32_t *lost)
+{
+    uint32_t written = CaptureWrittenGet();
+    size_t count = 0;
+
+    *lost = 0;
+    if (written - CaptureRead > CAPTURE_RING_SIZE - CAPTURE_RING_MARGIN)
+    {
+        *lost = written - CaptureRead - (CAPTURE_RING_SIZE - CAPTURE_RING_MARGIN);
+        CaptureRead += *lost;
+    }
+
+    while (count < maxSamples && CaptureRead != written)
+    {
+        unsigned index = CaptureRead++ % CAPTURE_RING_SIZE;
+
+        // Shift the PORTA8 bit into the gap from the missing PORTB2 bit
+        samples[count++] = (CaptureBank1[index] & PIN_INPUT_BANK1_ALL) |
+                           (((CaptureBank2[index] << 8) & PIN_INPUT_BANK2_ALL) >> 6);
+    }
+
+    return count;
+}
+#endif
+
+uint32_t BoardEnterCritical()
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    return primask;
+}
+
+void BoardExitCritical(uint32_t state)
+{
+    __set_PRIMASK(state);
+}
+
 #ifdef ENABLE_UART_DEBUG
 int BoardDebugPrint(const char *format, ...)
 {
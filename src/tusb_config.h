@@ -100,8 +100,14 @@
 #define CFG_TUD_MIDI              0
 #define CFG_TUD_VENDOR            0
 
-// HID buffer size Should be sufficient to hold ID (if any) + Data
+// HID buffer size Should be sufficient to hold ID (if any) + Data. Every report
+// uses the full buffer size: 8 bytes to match the ADU218 by default, or the
+// full-speed maximum of 64 bytes in the extended report mode.
+#ifdef ENABLE_EXTENDED_REPORTS
+#define CFG_TUD_HID_EP_BUFSIZE    64
+#else
 #define CFG_TUD_HID_EP_BUFSIZE    8
+#endif
 
 #ifdef __cplusplus
  }
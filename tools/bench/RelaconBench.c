@@ -0,0 +1,512 @@
+/*
+Copyright 2021 Frank Jenner
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * Host-native command throughput benchmark. Each mix file given on the command
+ * line is a recorded sequence of ADU command reports (one per line, '#' starts
+ * a comment) that is replayed through AduProtocolProcessCommand() and
+ * AduProtocolPopResponse() exactly as the USB layer would deliver it. A line
+ * starting with '!' is instead an extended binary command written as hex bytes
+ * (opcode first), which is replayed through ExtProtocolProcessCommand() and
+ * ExtProtocolGetResponse(). While the mix is replayed, the simulated board
+ * advances virtual time and toggles the digital inputs so that the event
+ * counter and watchdog tasks do real work in between commands. The event
+ * counter task is timed as well, since it runs on every iteration of the
+ * firmware's main loop.
+ *
+ * Each mix is then replayed once more through the USB layer and the simulated
+ * USB stack, in bursts of reports that arrive while the main loop is busy,
+ * with the firmware's own scheduler running the main loop. This times whole
+ * main loop iterations, whose worst case is the longest that any task can be
+ * held up, to compare processing commands from the main loop with processing
+ * them within the USB stack's callback.
+ */
+
+#include "AduProtocol.h"
+#include "EdgeLog.h"
+#include "EventCounter.h"
+#include "ExtProtocol.h"
+#include "InputNotify.h"
+#include "Profiler.h"
+#include "RelayPulse.h"
+#include "Scheduler.h"
+#include "Sequencer.h"
+#include "Streaming.h"
+#include "Usb.h"
+#include "Watchdog.h"
+#include "boards/Board.h"
+#include "HostBoard.h"
+#include "HostUsb.h"
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/** Size of a HID report, including the report ID byte */
+#ifndef BENCH_REPORT_SIZE
+#ifdef ENABLE_EXTENDED_REPORTS
+#define BENCH_REPORT_SIZE       64
+#else
+#define BENCH_REPORT_SIZE       8
+#endif
+#endif
+
+/** Size of the command payload handed to the protocol layer */
+#define REPORT_PAYLOAD_SIZE     (BENCH_REPORT_SIZE - 1)
+
+/** Maximum length of a line in a mix file */
+#define MAX_LINE_SIZE           128
+
+/** Maximum number of commands in a single mix file */
+#define MAX_MIX_COMMANDS        256
+
+/** Latency histogram resolution: one bucket per nanosecond up to this value */
+#define LATENCY_HISTOGRAM_NS    20000
+
+/** The report IDs of ADU and extended commands */
+#define REPORT_ID_ADU_CMD_RSP   1
+#define REPORT_ID_EXT_CMD_RSP   4
+
+/**
+ * The number of reports that arrive together while the main loop is busy,
+ * matching the depth of the firmware's receive queue
+ */
+#define USB_BURST_SIZE          4
+
+#define DEFAULT_NUM_PASSES      20000
+#define DEFAULT_TIME_STEP_US    100
+
+/** A single command from a mix file, along with its latency statistics */
+struct BenchCommand
+{
+    bool Extended;
+    uint8_t Payload[REPORT_PAYLOAD_SIZE];
+    char Text[MAX_LINE_SIZE];
+    uint64_t Count;
+    uint64_t Failures;
+    uint64_t TotalNs;
+    uint64_t MinNs;
+    uint64_t MaxNs;
+};
+
+static struct BenchCommand Commands[MAX_MIX_COMMANDS];
+static unsigned NumCommands;
+
+/** Latency histogram across all commands of the current mix */
+static uint64_t LatencyHistogram[LATENCY_HISTOGRAM_NS + 1];
+
+/** The main loop tasks, scheduled as in the firmware */
+static const struct SchedulerTask TASKS[] =
+{
+    { EventCounterTask, EventCounterTaskDelayUs, 100, PROFILER_TASK_EVENT_COUNTER },
+    { WatchdogTask, WatchdogTaskDelayUs, 0, PROFILER_TASK_WATCHDOG },
+    { StreamingTask, StreamingTaskDelayUs, 0, PROFILER_TASK_STREAMING },
+    { UsbTask, UsbTaskDelayUs, 1000, PROFILER_TASK_USB },
+};
+
+static uint64_t NowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+/**
+ * Decodes the hex bytes of an extended command, ignoring whitespace between
+ * them
+ *
+ * @param[in] text The hex bytes
+ * @param[out] payload The buffer to populate with the decoded bytes
+ * @param[out] len The number of decoded bytes
+ *
+ * @return Returns true on success, or false if the text isn't valid hex or
+ *         doesn't fit in a report
+ */
+static bool DecodeHex(const char *text, uint8_t payload[REPORT_PAYLOAD_SIZE], size_t *len)
+{
+    bool success = true;
+    *len = 0;
+
+    while (success && *text != '\0')
+    {
+        if (*text == ' ' || *text == '\t')
+        {
+            text++;
+        }
+        else if (*len < REPORT_PAYLOAD_SIZE &&
+                 isxdigit((unsigned char)text[0]) && isxdigit((unsigned char)text[1]))
+        {
+            char digits[3] = { text[0], text[1], '\0' };
+
+            payload[(*len)++] = strtoul(digits, NULL, 16);
+            text += 2;
+        }
+        else
+        {
+            success = false;
+        }
+    }
+
+    return success;
+}
+
+/**
+ * Loads a mix file into the command table
+ *
+ * @param[in] path The path of the mix file
+ *
+ * @return Returns true on success or false on failure
+ */
+static bool LoadMix(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        perror(path);
+        return false;
+    }
+
+    bool success = true;
+    char line[MAX_LINE_SIZE];
+    unsigned lineNum = 0;
+    NumCommands = 0;
+
+    while (success && fgets(line, sizeof(line), file) != NULL)
+    {
+        lineNum++;
+
+        // Strip comments and trailing whitespace
+        char *comment = strchr(line, '#');
+        if (comment != NULL)
+            *comment = '\0';
+
+        size_t len = strlen(line);
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r' ||
+                           line[len - 1] == ' ' || line[len - 1] == '\t'))
+        {
+            line[--len] = '\0';
+        }
+
+        if (len == 0)
+            continue;
+
+        if (NumCommands == MAX_MIX_COMMANDS)
+        {
+            fprintf(stderr, "%s:%u: too many commands\n", path, lineNum);
+            success = false;
+        }
+        else
+        {
+            // Commands arrive zero-padded to the full report size
+            struct BenchCommand *cmd = &Commands[NumCommands++];
+            memset(cmd, 0, sizeof(*cmd));
+            memcpy(cmd->Text, line, len);
+            cmd->MinNs = UINT64_MAX;
+
+            if (line[0] == '!')
+            {
+                cmd->Extended = true;
+                if (!DecodeHex(&line[1], cmd->Payload, &len) || len == 0)
+                {
+                    fprintf(stderr, "%s:%u: invalid extended command\n", path, lineNum);
+                    success = false;
+                }
+            }
+            else if (len <= REPORT_PAYLOAD_SIZE)
+            {
+                memcpy(cmd->Payload, line, len);
+            }
+            else
+            {
+                fprintf(stderr, "%s:%u: command does not fit in a report\n", path, lineNum);
+                success = false;
+            }
+        }
+    }
+
+    fclose(file);
+
+    if (success && NumCommands == 0)
+    {
+        fprintf(stderr, "%s: no commands\n", path);
+        success = false;
+    }
+
+    return success;
+}
+
+/**
+ * Returns the latency (in ns) below which the given fraction of the samples
+ * in the latency histogram fall
+ */
+static uint64_t LatencyPercentile(uint64_t numSamples, double fraction)
+{
+    uint64_t threshold = (uint64_t)(numSamples * fraction);
+    uint64_t seen = 0;
+
+    for (unsigned i = 0; i <= LATENCY_HISTOGRAM_NS; i++)
+    {
+        seen += LatencyHistogram[i];
+        if (seen > threshold)
+            return i;
+    }
+
+    return LATENCY_HISTOGRAM_NS;
+}
+
+/**
+ * Replays the loaded mix through the protocol layer and prints the results
+ *
+ * @param[in] name The name of the mix, for reporting
+ * @param[in] numPasses The number of times to replay the whole mix
+ * @param[in] timeStepUs The virtual time that elapses between commands
+ */
+static void RunMix(const char *name, unsigned numPasses, uint32_t timeStepUs)
+{
+    uint8_t rspBuf[BENCH_REPORT_SIZE];
+    uint8_t extRspBuf[EXT_PROTOCOL_MAX_RESPONSE_SIZE];
+    uint64_t numSamples = 0;
+    uint64_t totalNs = 0;
+    uint64_t numFailures = 0;
+    uint64_t taskTotalNs = 0;
+    uint64_t taskMaxNs = 0;
+    uint8_t inputs = 0;
+
+    memset(LatencyHistogram, 0, sizeof(LatencyHistogram));
+
+    BoardInit();
+    EventCounterInit();
+    WatchdogInit();
+    RelayPulseInit();
+    SequencerInit();
+
+    for (unsigned pass = 0; pass < numPasses; pass++)
+    {
+        for (unsigned i = 0; i < NumCommands; i++)
+        {
+            struct BenchCommand *cmd = &Commands[i];
+
+            // Keep the rest of the superloop busy between commands
+            HostBoardAdvanceTimeUs(timeStepUs);
+            HostBoardSetDigitalInputs(inputs++);
+
+            uint64_t taskStart = NowNs();
+            EventCounterTask();
+            uint64_t taskElapsed = NowNs() - taskStart;
+
+            taskTotalNs += taskElapsed;
+            if (taskElapsed > taskMaxNs)
+                taskMaxNs = taskElapsed;
+
+            WatchdogTask();
+
+            uint64_t start = NowNs();
+            bool success;
+            if (cmd->Extended)
+            {
+                success = ExtProtocolProcessCommand(cmd->Payload, sizeof(cmd->Payload));
+                ExtProtocolGetResponse(extRspBuf, sizeof(extRspBuf));
+            }
+            else
+            {
+                success = AduProtocolProcessCommand(cmd->Payload, sizeof(cmd->Payload));
+                while (AduProtocolPopResponse(rspBuf, sizeof(rspBuf)) > 0)
+                    ;
+            }
+            uint64_t elapsed = NowNs() - start;
+
+            cmd->Count++;
+            cmd->TotalNs += elapsed;
+            if (elapsed < cmd->MinNs)
+                cmd->MinNs = elapsed;
+            if (elapsed > cmd->MaxNs)
+                cmd->MaxNs = elapsed;
+            if (!success)
+            {
+                cmd->Failures++;
+                numFailures++;
+            }
+
+            LatencyHistogram[elapsed < LATENCY_HISTOGRAM_NS ? elapsed : LATENCY_HISTOGRAM_NS]++;
+            totalNs += elapsed;
+            numSamples++;
+        }
+    }
+
+    printf("mix %s: %u commands x %u passes\n", name, NumCommands, numPasses);
+    printf("  throughput: %.0f commands/sec\n", numSamples * 1e9 / totalNs);
+    printf("  latency ns: avg %.1f  p50 %llu  p99 %llu  p99.9 %llu\n",
+           (double)totalNs / numSamples,
+           (unsigned long long)LatencyPercentile(numSamples, 0.50),
+           (unsigned long long)LatencyPercentile(numSamples, 0.99),
+           (unsigned long long)LatencyPercentile(numSamples, 0.999));
+    printf("  failures: %llu\n", (unsigned long long)numFailures);
+    printf("  event counter task ns: avg %.1f  max %llu\n",
+           (double)taskTotalNs / numSamples, (unsigned long long)taskMaxNs);
+    printf("  %-20s %10s %8s %8s %8s\n", "command", "count", "min", "avg", "max");
+
+    for (unsigned i = 0; i < NumCommands; i++)
+    {
+        const struct BenchCommand *cmd = &Commands[i];
+        printf("  %-20s %10llu %8llu %8.1f %8llu%s\n", cmd->Text,
+               (unsigned long long)cmd->Count,
+               (unsigned long long)cmd->MinNs,
+               (double)cmd->TotalNs / cmd->Count,
+               (unsigned long long)cmd->MaxNs,
+               cmd->Failures ? "  (failed)" : "");
+    }
+}
+
+/**
+ * Replays the loaded mix through the USB layer and the main loop, and prints
+ * the main loop iteration times
+ *
+ * @param[in] numPasses The number of times to replay the whole mix
+ * @param[in] timeStepUs The virtual time that elapses between main loop
+ *                       iterations
+ */
+static void RunMixThroughUsb(unsigned numPasses, uint32_t timeStepUs)
+{
+    uint64_t numIterations = 0;
+    uint64_t totalNs = 0;
+    uint64_t maxNs = 0;
+    uint8_t inputs = 0;
+
+    memset(LatencyHistogram, 0, sizeof(LatencyHistogram));
+
+    BoardInit();
+    EventCounterInit();
+    EdgeLogInit();
+    InputNotifyInit();
+    WatchdogInit();
+    StreamingInit();
+    UsbInit();
+    ProfilerInit();
+    RelayPulseInit();
+    SequencerInit();
+    SchedulerInit(TASKS, sizeof(TASKS) / sizeof(TASKS[0]));
+    UsbReadDroppedReports(true);
+
+    for (unsigned pass = 0; pass < numPasses; pass++)
+    {
+        for (unsigned i = 0; i < NumCommands; i++)
+        {
+            struct BenchCommand *cmd = &Commands[i];
+
+            HostUsbSendOutputReport(cmd->Extended ? REPORT_ID_EXT_CMD_RSP : REPORT_ID_ADU_CMD_RSP,
+                                    cmd->Payload, sizeof(cmd->Payload));
+
+            if ((i + 1) % USB_BURST_SIZE == 0 || i + 1 == NumCommands)
+            {
+                bool busy = true;
+
+                HostBoardSetDigitalInputs(inputs++);
+
+                // Run the main loop until every report has been processed and
+                // every response has been sent
+                while (busy)
+                {
+                    HostBoardAdvanceTimeUs(timeStepUs);
+                    HostUsbReadInputReports(true);
+
+                    uint64_t start = NowNs();
+                    SchedulerRun();
+                    uint64_t elapsed = NowNs() - start;
+
+                    LatencyHistogram[elapsed < LATENCY_HISTOGRAM_NS ? elapsed : LATENCY_HISTOGRAM_NS]++;
+                    totalNs += elapsed;
+                    if (elapsed > maxNs)
+                        maxNs = elapsed;
+                    numIterations++;
+
+                    busy = HostUsbReadInputReports(false) > 0 || UsbTaskDelayUs() == 0;
+                }
+            }
+        }
+    }
+
+#ifdef ENABLE_DEFERRED_COMMANDS
+    printf("  via USB (deferred commands):\n");
+#else
+    printf("  via USB (commands processed in the callback):\n");
+#endif
+    printf("    main loop iteration ns: avg %.1f  p99 %llu  p99.9 %llu  max %llu\n",
+           (double)totalNs / numIterations,
+           (unsigned long long)LatencyPercentile(numIterations, 0.99),
+           (unsigned long long)LatencyPercentile(numIterations, 0.999),
+           (unsigned long long)maxNs);
+    printf("    dropped reports: %lu\n", (unsigned long)UsbReadDroppedReports(false));
+}
+
+static void Usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [-n passes] [-t step_us] mixfile...\n"
+            "  -n passes   number of times to replay each mix (default %u)\n"
+            "  -t step_us  virtual time between commands (default %u)\n",
+            argv0, DEFAULT_NUM_PASSES, DEFAULT_TIME_STEP_US);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned numPasses = DEFAULT_NUM_PASSES;
+    uint32_t timeStepUs = DEFAULT_TIME_STEP_US;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:t:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': numPasses = strtoul(optarg, NULL, 0); break;
+            case 't': timeStepUs = strtoul(optarg, NULL, 0); break;
+            default: Usage(argv[0]); return 2;
+        }
+    }
+
+    if (optind >= argc || numPasses == 0)
+    {
+        Usage(argv[0]);
+        return 2;
+    }
+
+    for (int i = optind; i < argc; i++)
+    {
+        if (!LoadMix(argv[i]))
+            return 1;
+        RunMix(argv[i], numPasses, timeStepUs);
+        RunMixThroughUsb(numPasses, timeStepUs);
+    }
+
+    return 0;
+}
@@ -0,0 +1,101 @@
+/*
+Copyright 2021 Frank Jenner
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "HostUsb.h"
+#include "tusb.h"
+
+/** An output report from the host, awaiting delivery to the firmware */
+struct PendingReport
+{
+    uint8_t Data[CFG_TUD_HID_EP_BUFSIZE];
+};
+
+/** Output reports awaiting delivery, oldest first */
+static struct PendingReport PendingReports[HOST_USB_MAX_PENDING_REPORTS];
+static unsigned NumPendingReports;
+
+/** The number of input reports sent by the firmware */
+static uint32_t InputReports;
+
+bool tusb_init()
+{
+    NumPendingReports = 0;
+    InputReports = 0;
+
+    return true;
+}
+
+void tud_task()
+{
+    // As on the OUT endpoint, the report ID is the first byte of the payload
+    for (unsigned i = 0; i < NumPendingReports; i++)
+        tud_hid_set_report_cb(0, HID_REPORT_TYPE_INVALID, PendingReports[i].Data, CFG_TUD_HID_EP_BUFSIZE);
+
+    NumPendingReports = 0;
+}
+
+bool tud_hid_ready()
+{
+    // The simulated host takes every input report as soon as it is sent
+    return true;
+}
+
+bool tud_hid_report(uint8_t report_id, void const* report, uint8_t len)
+{
+    InputReports++;
+
+    return true;
+}
+
+bool HostUsbSendOutputReport(uint8_t reportId, const uint8_t *payload, size_t len)
+{
+    bool success = false;
+
+    if (NumPendingReports < HOST_USB_MAX_PENDING_REPORTS && len < CFG_TUD_HID_EP_BUFSIZE)
+    {
+        struct PendingReport *report = &PendingReports[NumPendingReports++];
+
+        memset(report->Data, 0, sizeof(report->Data));
+        report->Data[0] = reportId;
+        memcpy(&report->Data[1], payload, len);
+        success = true;
+    }
+
+    return success;
+}
+
+uint32_t HostUsbReadInputReports(bool resetAfterRead)
+{
+    uint32_t ret = InputReports;
+
+    if (resetAfterRead)
+        InputReports = 0;
+
+    return ret;
+}
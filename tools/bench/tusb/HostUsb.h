@@ -0,0 +1,72 @@
+/*
+Copyright 2021 Frank Jenner
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef HOST_USB_H
+#define HOST_USB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * Simulation controls for the host-native stand-in for the TinyUSB device
+ * stack. These allow a host program (e.g. the benchmark) to stand in for the
+ * USB host by sending output reports to the firmware and collecting its input
+ * reports.
+ */
+
+/** The number of output reports that can await delivery to the firmware */
+#define HOST_USB_MAX_PENDING_REPORTS    16
+
+/**
+ * Sends an output report to the firmware on the HID OUT endpoint. Like
+ * reports that arrive while the firmware's main loop is busy, it is delivered
+ * from within the next call to tud_task(), along with any others sent since
+ * the last call.
+ *
+ * @param[in] reportId The report ID
+ * @param[in] payload The report payload (excluding the report ID)
+ * @param[in] len The length of the payload, which is zero-padded to the full
+ *                report size
+ *
+ * @return Returns true on success, or false if too many reports are already
+ *         awaiting delivery
+ */
+bool HostUsbSendOutputReport(uint8_t reportId, const uint8_t *payload, size_t len);
+
+/**
+ * Gets the number of input reports that the firmware has sent to the host
+ *
+ * @param[in] resetAfterRead True to reset the count after reading it
+ *
+ * @return Returns the number of input reports sent
+ */
+uint32_t HostUsbReadInputReports(bool resetAfterRead);
+
+#endif
@@ -0,0 +1,73 @@
+/*
+Copyright 2021 Frank Jenner
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * Stand-in for the TinyUSB device stack's public header, so that the USB layer
+ * (src/Usb.c) can be compiled natively for the build host. Only the parts of
+ * the API that the firmware uses are provided, backed by the simulated stack
+ * in HostUsb.c.
+ */
+
+#ifndef TUSB_H
+#define TUSB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Just enough of the stack's options for the firmware's configuration to pick
+// a full-speed device port
+#define OPT_MCU_NONE                0
+#define OPT_OS_NONE                 1
+#define OPT_MODE_DEVICE             0x01
+#define OPT_MODE_FULL_SPEED         0x00
+#define CFG_TUSB_MCU                OPT_MCU_NONE
+#define BOARD_DEVICE_RHPORT_SPEED   OPT_MODE_FULL_SPEED
+
+#include "tusb_config.h"
+
+typedef enum
+{
+    HID_REPORT_TYPE_INVALID = 0,
+    HID_REPORT_TYPE_INPUT,
+    HID_REPORT_TYPE_OUTPUT,
+    HID_REPORT_TYPE_FEATURE
+} hid_report_type_t;
+
+bool tusb_init();
+void tud_task();
+bool tud_hid_ready();
+bool tud_hid_report(uint8_t report_id, void const* report, uint8_t len);
+
+// Callbacks implemented by the firmware
+uint16_t tud_hid_get_report_cb(uint8_t report_id, hid_report_type_t report_type, uint8_t* buffer, uint16_t reqlen);
+void tud_hid_set_report_cb(uint8_t report_id, hid_report_type_t report_type, uint8_t const* buffer, uint16_t bufsize);
+bool tud_hid_set_idle_cb(uint8_t idle_rate);
+
+#endif
@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+
+#
+# Copyright 2021 Frank Jenner
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+# 1. Redistributions of source code must retain the above copyright notice, this
+#    list of conditions and the following disclaimer.
+#
+# 2. Redistributions in binary form must reproduce the above copyright notice,
+#    this list of conditions and the following disclaimer in the documentation
+#    and/or other materials provided with the distribution.
+#
+# 3. Neither the name of the copyright holder nor the names of its contributors
+#    may be used to endorse or promote products derived from this software
+#    without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+# FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+# SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+# CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+# OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+
+#
+# Measures the end-to-end command/response latency of a Relacon (or ADU218)
+# over USB HID, as seen by a host application. Each iteration sends one ADU
+# command on report ID 1 and times how long it takes for the response report
+# to arrive. With --pipeline, up to that many tagged commands are kept in
+# flight at once, and each response is matched to its command by its tag.
+# Requires the hidapi Python bindings (pip install hidapi).
+#
+
+import argparse
+import statistics
+import time
+
+import hid
+
+# The ADU command/response reports use report ID 1
+REPORT_ID_ADU_CMD_RSP = 1
+
+# Tagged commands and responses begin with '@' and a one-character tag
+TAG_PREFIX = ord('@')
+TAGS = '0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz'
+
+def make_command_report(command, report_size):
+    payload = command.encode('ascii')
+    if len(payload) > report_size - 1:
+        raise ValueError('command "%s" is too long for one report' % command)
+    return [REPORT_ID_ADU_CMD_RSP] + list(payload) + [0] * (report_size - 1 - len(payload))
+
+def drain_input_reports(dev, report_size):
+    # Discard any stale responses so they aren't mistaken for new ones
+    while dev.read(report_size, 10):
+        pass
+
+def measure_round_trip(dev, report, timeout_ms):
+    start = time.perf_counter()
+    dev.write(report)
+    while True:
+        remaining_ms = timeout_ms - (time.perf_counter() - start) * 1000
+        if remaining_ms <= 0:
+            return None
+        response = dev.read(len(report), max(1, int(remaining_ms)))
+        if response and response[0] == REPORT_ID_ADU_CMD_RSP:
+            return time.perf_counter() - start
+
+def measure_pipelined(dev, command, report_size, count, depth, timeout_ms):
+    latencies = []
+    in_flight = {}
+    next_tag = 0
+    sent = 0
+    timeouts = 0
+
+    while sent < count or in_flight:
+        # Keep the pipeline full
+        while sent < count and len(in_flight) < depth:
+            tag = TAGS[next_tag % len(TAGS)]
+            next_tag += 1
+            if tag in in_flight:
+                break
+            in_flight[tag] = time.perf_counter()
+            dev.write(make_command_report('@' + tag + command, report_size))
+            sent += 1
+
+        response = dev.read(report_size, timeout_ms)
+        if not response:
+            # Give up on everything still outstanding
+            timeouts += len(in_flight)
+            in_flight.clear()
+        elif response[0] == REPORT_ID_ADU_CMD_RSP and response[1] == TAG_PREFIX:
+            start = in_flight.pop(chr(response[2]), None)
+            if start is not None:
+                latencies.append(time.perf_counter() - start)
+
+    return latencies, timeouts
+
+def percentile(sorted_values, fraction):
+    index = min(len(sorted_values) - 1, int(round(fraction * (len(sorted_values) - 1))))
+    return sorted_values[index]
+
+def run(args):
+    dev = hid.device()
+    dev.open(args.vid, args.pid, args.serial)
+    try:
+        print('Device: %s %s (serial %s)' % (dev.get_manufacturer_string(), dev.get_product_string(), dev.get_serial_number_string()))
+        drain_input_reports(dev, args.report_size)
+
+        if args.pipeline > 1:
+            measure_pipelined(dev, args.command, args.report_size, args.warmup, args.pipeline, args.timeout)
+            start = time.perf_counter()
+            latencies, timeouts = measure_pipelined(dev, args.command, args.report_size, args.count, args.pipeline, args.timeout)
+        else:
+            report = make_command_report(args.command, args.report_size)
+            for _ in range(args.warmup):
+                measure_round_trip(dev, report, args.timeout)
+
+            start = time.perf_counter()
+            latencies = []
+            timeouts = 0
+            for _ in range(args.count):
+                latency = measure_round_trip(dev, report, args.timeout)
+                if latency is None:
+                    timeouts += 1
+                else:
+                    latencies.append(latency)
+        elapsed = time.perf_counter() - start
+    finally:
+        dev.close()
+
+    if not latencies:
+        print('No responses received to "%s"' % args.command)
+        return
+
+    latencies = sorted(latency * 1000 for latency in latencies)
+    print('Command "%s": %d round trips (%d in flight), %d timeouts' % (args.command, len(latencies), max(1, args.pipeline), timeouts))
+    print('  min    %7.3f ms' % latencies[0])
+    print('  median %7.3f ms' % statistics.median(latencies))
+    print('  mean   %7.3f ms' % statistics.mean(latencies))
+    print('  p99    %7.3f ms' % percentile(latencies, 0.99))
+    print('  max    %7.3f ms' % latencies[-1])
+    print('  rate   %7.1f commands/s' % (len(latencies) / elapsed))
+
+# Configure command line argument processing
+parser = argparse.ArgumentParser(description='Measure the command/response latency of a Relacon over USB HID')
+parser.add_argument('--vid', type=lambda x: int(x, 0), default=0x1209, help='USB vendor ID of the device (default 0x1209)')
+parser.add_argument('--pid', type=lambda x: int(x, 0), default=0xfa70, help='USB product ID of the device (default 0xfa70)')
+parser.add_argument('--serial', default=None, help='serial number of the device, if more than one is attached')
+parser.add_argument('-c', '--command', default='RPA0', help='ADU command that elicits a response (default RPA0)')
+parser.add_argument('-n', '--count', type=int, default=1000, help='number of timed round trips (default 1000)')
+parser.add_argument('-w', '--warmup', type=int, default=10, help='number of untimed round trips first (default 10)')
+parser.add_argument('-p', '--pipeline', type=int, default=1, help='number of tagged commands to keep in flight; the device queues at most 16 responses (default 1, untagged stop-and-wait)')
+parser.add_argument('-s', '--report-size', type=int, choices=[8, 64], default=8, help='HID report size including the report ID: 64 for firmware built with ENABLE_EXTENDED_REPORTS=1 (default 8)')
+parser.add_argument('-t', '--timeout', type=int, default=500, help='response timeout in ms (default 500)')
+
+# Run the latency measurement based on the command line options
+run(parser.parse_args())